@@ -0,0 +1,166 @@
+// Aliasing and cost of the germanium diode against its first and second
+// order antiderivative antialiased variants, at 1x, 2x and 4x the base
+// rate. Also checks the closed form antiderivatives against the diode.
+//
+// Sines of a whole number of cycles per analysis frame put the harmonics,
+// and what folds back from above Nyquist, on exact DFT bins. Aliases never
+// land on multiples of the fundamental bin, their energy below 20 kHz
+// against the fundamental is the figure printed.
+//
+// Build and run from the repository root:
+//   g++ -O2 -std=c++17 -Isrc -o scripts/adaa_bench scripts/cpp/adaa_bench.cpp
+//   ./scripts/adaa_bench
+
+#include "dsp/circuits/germanium_diode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+const double pi = 3.14159265358979323846;
+const double base_rate = 44100.0;
+const int frame = 4096;
+
+struct Plain
+{
+    GermaniumDiode diode;
+    Plain(float fs) : diode(fs) {}
+    float processSample(float x)
+    {
+        return diode.processSample(x);
+    }
+};
+
+template <int Order> struct Antialiased
+{
+    AntialiasedGermaniumDiode<Order> diode;
+    Antialiased(float fs) : diode(fs) {}
+    float processSample(float x)
+    {
+        return diode.processSample(x);
+    }
+};
+
+// Alias to fundamental ratio in dB below 20 kHz
+template <typename Stage>
+double aliasing(int factor, int cycles, double amplitude)
+{
+    const int n = frame * factor;
+    const double fs = base_rate * factor;
+    Stage stage(static_cast<float>(fs));
+    std::vector<double> y(n);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            double x = amplitude * std::sin(2.0 * pi * cycles * i / n);
+            y[i] = stage.processSample(static_cast<float>(x));
+        }
+    }
+
+    const int last_bin = static_cast<int>(20000.0 / (base_rate / frame));
+    double fundamental = 0.0, aliases = 0.0;
+    for (int bin = 1; bin <= last_bin; ++bin)
+    {
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; ++i)
+        {
+            double phase = 2.0 * pi * double(bin) * i / n;
+            re += y[i] * std::cos(phase);
+            im -= y[i] * std::sin(phase);
+        }
+        double energy = re * re + im * im;
+        if (bin == cycles)
+            fundamental = energy;
+        else if (bin % cycles != 0)
+            aliases += energy;
+    }
+    return 10.0 * std::log10(aliases / fundamental + 1e-30);
+}
+
+template <typename Stage> double cost()
+{
+    const int n = 1 << 16;
+    std::vector<float> x(n);
+    for (int i = 0; i < n; ++i)
+        x[i] = 2.0f * std::sin(2.0f * 3.14159265f * 1000.0f * i / 88200.0f);
+    double best = 1e30;
+    for (int run = 0; run < 5; ++run)
+    {
+        Stage stage(88200.0f);
+        float sum = 0.0f;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i)
+            sum += stage.processSample(x[i]);
+        auto end = std::chrono::steady_clock::now();
+        volatile float sink = sum;
+        (void)sink;
+        best = std::min(
+            best, std::chrono::duration<double, std::nano>(end - start).count()
+        );
+    }
+    return best / n;
+}
+
+// The derivative of each antiderivative, by central differences, against
+// the function it integrates
+bool checkIntegrals()
+{
+    GermaniumDiode diode(88200.0f);
+    double worst = 0.0, worst2 = 0.0;
+    for (double v = -4.0; v <= 4.0; v += 0.0137)
+    {
+        double h = 1e-4;
+        double d1 =
+            (diode.shapeIntegral(v + h) - diode.shapeIntegral(v - h)) / (2 * h);
+        double d2 =
+            (diode.shapeIntegral2(v + h) - diode.shapeIntegral2(v - h)) /
+            (2 * h);
+        worst = std::max(worst, std::abs(d1 - diode.preciseShape(v)));
+        worst2 = std::max(worst2, std::abs(d2 - diode.shapeIntegral(v)));
+    }
+    bool ok = worst < 1e-5 && worst2 < 1e-5;
+    std::printf(
+        "%-4s antiderivatives: worst slope error %.2g, %.2g\n",
+        ok ? "ok" : "FAIL", worst, worst2
+    );
+    return ok;
+}
+} // namespace
+
+int main()
+{
+    bool ok = checkIntegrals();
+
+    const int tones[] = {139, 373};
+    for (int cycles : tones)
+    {
+        double frequency = cycles * base_rate / frame;
+        for (double amplitude : {0.5, 2.0})
+        {
+            std::printf(
+                "%6.0f Hz, amplitude %.1f   plain   adaa1   adaa2 (dB)\n",
+                frequency, amplitude
+            );
+            for (int factor : {1, 2, 4})
+            {
+                std::printf(
+                    "  %dx                    %7.1f %7.1f %7.1f\n", factor,
+                    aliasing<Plain>(factor, cycles, amplitude),
+                    aliasing<Antialiased<1>>(factor, cycles, amplitude),
+                    aliasing<Antialiased<2>>(factor, cycles, amplitude)
+                );
+            }
+        }
+    }
+
+    std::printf(
+        "ns per sample: plain %.2f, adaa1 %.2f, adaa2 %.2f\n", cost<Plain>(),
+        cost<Antialiased<1>>(), cost<Antialiased<2>>()
+    );
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+// Checks that the pipelined SIMD path of BiquadCascade matches the section
+// by section one over blocks of varying sizes, and times both. Also sweeps
+// a low-pass across blocks, stepping the coefficients at the block starts
+// and gliding them, and compares the worst clicks.
+//
+// Build and run from the repository root:
+//   g++ -O2 -std=c++17 -Isrc -o scripts/biquad_bench
+//       scripts/cpp/biquad_bench.cpp
+//   ./scripts/biquad_bench
+//
+// With FMA enabled (-march=native) the two paths contract differently and
+// agree to about 1e-4 instead of exactly.
+
+#include "dsp/filters/biquad_cascade.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+// Peaking sections spread over the audio band
+template <int N> void design(BiquadCascade<N>& cascade)
+{
+    const double frequencies[] = {100, 500, 1500, 5000, 30, 967, 129, 2000};
+    for (int k = 0; k < N; ++k)
+    {
+        double w = 2.0 * 3.14159265358979323846 * frequencies[k] / 48000.0;
+        double alpha = std::sin(w) / (2.0 * 0.707);
+        double gain = 1.4;
+        double a0 = 1.0 + alpha / gain;
+        cascade.setSection(
+            k, float((1.0 + alpha * gain) / a0), float(-2.0 * std::cos(w) / a0),
+            float((1.0 - alpha * gain) / a0), float(-2.0 * std::cos(w) / a0),
+            float((1.0 - alpha / gain) / a0)
+        );
+    }
+}
+
+template <int N> bool run()
+{
+    BiquadCascade<N> serial, pipelined;
+    design(serial);
+    design(pipelined);
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<float> x(1 << 17);
+    for (float& v : x)
+        v = uniform(random);
+
+    std::vector<float> a = x;
+    for (float& v : a)
+        v = serial.processSample(v);
+
+    std::vector<float> b = x;
+    const int sizes[] = {1, 2, 3, 5, 64, 7, 512, 4, 1000};
+    int position = 0;
+    for (int i = 0; position < static_cast<int>(b.size()); ++i)
+    {
+        int n = std::min(sizes[i % 9], static_cast<int>(b.size()) - position);
+        pipelined.process(&b[position], n);
+        position += n;
+    }
+
+    double difference = 0.0;
+    for (size_t i = 0; i < x.size(); ++i)
+        difference = std::max(difference, double(std::abs(a[i] - b[i])));
+
+    const int block = 512;
+    const int repeats = 2000;
+    std::vector<float> buffer(block, 0.0f);
+    double serial_ns = 1e30, pipelined_ns = 1e30;
+    for (int run = 0; run < 5; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            for (int i = 0; i < block; ++i)
+                buffer[i] = serial.processSample(x[i]);
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            std::copy(x.begin(), x.begin() + block, buffer.begin());
+            pipelined.process(buffer.data(), block);
+        }
+        auto end = std::chrono::steady_clock::now();
+        using ns = std::chrono::duration<double, std::nano>;
+        serial_ns = std::min(serial_ns, ns(middle - start).count());
+        pipelined_ns = std::min(pipelined_ns, ns(end - middle).count());
+    }
+    serial_ns /= double(repeats) * block;
+    pipelined_ns /= double(repeats) * block;
+
+    bool ok = difference < 1e-3;
+    std::printf(
+        "%-4s %d sections: serial %5.2f ns, pipelined %5.2f ns, diff %.2g\n",
+        ok ? "ok" : "FAIL", N, serial_ns, pipelined_ns, difference
+    );
+    return ok;
+}
+
+// Largest second difference of the output, where steps show as clicks
+bool runGlide()
+{
+    const double sample_rate = 48000.0;
+    const int block = 256;
+    BiquadCascade<2> stepped, glided;
+    for (int k = 0; k < 2; ++k)
+    {
+        stepped.setSection(k, rbj::lowPass(sample_rate, 300.0));
+        glided.setSection(k, rbj::lowPass(sample_rate, 300.0));
+    }
+
+    std::vector<float> a(block), b(block);
+    double stepped_click = 0.0, glided_click = 0.0;
+    float a1 = 0.0f, a2 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+    int n = 0;
+    for (int j = 0; j < 64; ++j)
+    {
+        double cutoff = 300.0 * std::pow(2.0, 4.5 * (j % 32) / 31.0);
+        for (int k = 0; k < 2; ++k)
+        {
+            stepped.setSection(k, rbj::lowPass(sample_rate, cutoff));
+            glided.setTarget(k, rbj::lowPass(sample_rate, cutoff));
+        }
+        glided.glide(block);
+        for (int i = 0; i < block; ++i, ++n)
+            a[i] = b[i] = float(std::sin(2.0 * 3.14159265 * 110.0 * n / 48e3));
+        stepped.process(a.data(), block);
+        glided.process(b.data(), block);
+        for (int i = 0; i < block; ++i)
+        {
+            stepped_click = std::max(
+                stepped_click, double(std::abs(a[i] - 2.0f * a1 + a2))
+            );
+            glided_click = std::max(
+                glided_click, double(std::abs(b[i] - 2.0f * b1 + b2))
+            );
+            a2 = a1;
+            a1 = a[i];
+            b2 = b1;
+            b1 = b[i];
+        }
+    }
+
+    // Once the glide is over the coefficients are exactly the targets
+    BiquadCascade<2> snapped = glided;
+    double last_cutoff = 300.0 * std::pow(2.0, 4.5);
+    for (int k = 0; k < 2; ++k)
+        snapped.setSection(k, rbj::lowPass(sample_rate, last_cutoff));
+    double difference = 0.0;
+    for (int i = 0; i < block; ++i)
+    {
+        float x = float(std::sin(0.1 * i));
+        difference = std::max(
+            difference,
+            double(std::abs(glided.processSample(x) - snapped.processSample(x)))
+        );
+    }
+
+    bool ok = glided_click < stepped_click && difference == 0.0;
+    std::printf(
+        "%-4s glide: worst click stepped %.3g, glided %.3g\n",
+        ok ? "ok" : "FAIL", stepped_click, glided_click
+    );
+    return ok;
+}
+} // namespace
+
+int main()
+{
+    std::printf("simd width %d\n", simd::width);
+    bool ok = run<2>();
+    ok = run<3>() && ok;
+    ok = run<4>() && ok;
+    ok = run<6>() && ok;
+    ok = run<8>() && ok;
+    ok = runGlide() && ok;
+    return ok ? 0 : 1;
+}
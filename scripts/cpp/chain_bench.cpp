@@ -0,0 +1,319 @@
+// Per-sample cost of the oversampled Helios and Borealis cores composed
+// with Chain (src/dsp/circuits/chain.h), against the previous layout:
+// member juce::dsp::IIR::Filter objects, stood in for here by a filter with
+// the same shared, heap allocated coefficients and generic order loop, and
+// a virtual applyOverdrive call per sample. Both layouts must produce the
+// same output. The Borealis branches are also timed packed into the lanes
+// of ParallelBiquad.
+//
+// Build and run from the repository root:
+//   g++ -O2 -std=c++17 -Isrc -o scripts/chain_bench scripts/cpp/chain_bench.cpp
+//   ./scripts/chain_bench
+
+#include "dsp/circuits/chain.h"
+#include "dsp/circuits/germanium_diode.h"
+#include "dsp/circuits/triode.h"
+#include "dsp/filters/biquad.h"
+#include "dsp/filters/parallel_biquad.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace
+{
+const float sample_rate = 88200.0f;
+
+// Layout of juce::dsp::IIR::Filter: coefficients in a shared object,
+// state in a separate heap block, loop over the filter order.
+struct SharedCoefficients
+{
+    std::vector<float> coefficients;
+};
+
+class MemberFilter
+{
+  public:
+    std::shared_ptr<SharedCoefficients> coefficients =
+        std::make_shared<SharedCoefficients>();
+
+    void prepare()
+    {
+        order = (coefficients->coefficients.size() - 1) / 2;
+        state.assign(order, 0.0f);
+    }
+
+    float processSample(float sample)
+    {
+        const float* c = coefficients->coefficients.data();
+        float* s = state.data();
+        float output = c[0] * sample + s[0];
+        for (size_t j = 0; j < order - 1; ++j)
+            s[j] = c[j + 1] * sample - c[order + j + 1] * output + s[j + 1];
+        s[order - 1] = c[order] * sample - c[order * 2] * output;
+        return output;
+    }
+
+  private:
+    size_t order = 2;
+    std::vector<float> state;
+};
+
+// Normalised b0, b1, b2, a1, a2 of a few second order sections
+std::vector<float> lowPass(float frequency, float q)
+{
+    double n = 1.0 / std::tan(3.14159265358979323846 * frequency / sample_rate);
+    double n2 = n * n;
+    double c1 = 1.0 / (1.0 + n / q + n2);
+    return {float(c1), float(2.0 * c1), float(c1), float(c1 * 2.0 * (1.0 - n2)),
+            float(c1 * (1.0 - n / q + n2))};
+}
+
+std::vector<float> highPass(float frequency, float q)
+{
+    double n = std::tan(3.14159265358979323846 * frequency / sample_rate);
+    double n2 = n * n;
+    double c1 = 1.0 / (1.0 + n / q + n2);
+    return {float(c1), float(-2.0 * c1), float(c1),
+            float(c1 * 2.0 * (n2 - 1.0)), float(c1 * (1.0 - n / q + n2))};
+}
+
+void assign(MemberFilter& filter, const std::vector<float>& c)
+{
+    filter.coefficients->coefficients = c;
+    filter.prepare();
+}
+
+void assign(Biquad& filter, const std::vector<float>& c)
+{
+    filter.setCoefficients(c[0], c[1], c[2], c[3], c[4]);
+}
+
+struct Core
+{
+    virtual ~Core() = default;
+    virtual void applyOverdrive(float& sample, float sampleRate) = 0;
+
+    void process(float* samples, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            float sample = samples[i];
+            applyOverdrive(sample, sample_rate);
+            samples[i] = sample;
+        }
+    }
+};
+
+struct MemberHelios : Core
+{
+    MemberFilter dc_hpf;
+    MemberFilter dc_hpf2;
+    Triode<Tube12AX7> triode_pre{sample_rate};
+    Triode<Tube12AX7> triode_pre2{sample_rate};
+    float drive_gain = 4.0f;
+
+    MemberHelios()
+    {
+        assign(dc_hpf, highPass(20.0f, 0.7071f));
+        assign(dc_hpf2, highPass(20.0f, 0.7071f));
+    }
+
+    void applyOverdrive(float& sample, float) override
+    {
+        float preamped1 =
+            drive_gain * dc_hpf.processSample(triode_pre.processSample(sample));
+        sample = dc_hpf2.processSample(triode_pre2.processSample(preamped1));
+    }
+};
+
+struct ChainHelios
+{
+    Chain<Triode<Tube12AX7>, DCBlock, Gain, Triode<Tube12AX7>, DCBlock>
+        preamp;
+
+    ChainHelios()
+    {
+        preamp.get<0>() = Triode<Tube12AX7>(sample_rate);
+        preamp.get<1>().prepare(sample_rate);
+        preamp.get<2>().setGain(4.0f);
+        preamp.get<3>() = Triode<Tube12AX7>(sample_rate);
+        preamp.get<4>().prepare(sample_rate);
+    }
+
+    void process(float* samples, int n)
+    {
+        preamp.process(samples, n);
+    }
+};
+
+struct MemberBorealis : Core
+{
+    Triode<Tube12AX7> triode{sample_rate};
+    GermaniumDiode diode{sample_rate};
+    MemberFilter ff1_lpf, ff2_hpf, ff2_lpf, pre_hpf, pre_lpf, attack_shelf;
+    float drive_gain = 2.0f;
+
+    MemberBorealis()
+    {
+        assign(ff1_lpf, lowPass(106.0f, 0.7071f));
+        assign(ff2_hpf, lowPass(153.0f, 0.7071f));
+        assign(ff2_lpf, lowPass(272.0f, 0.7071f));
+        assign(pre_hpf, highPass(129.0f, 0.7071f));
+        assign(pre_lpf, lowPass(967.0f, 0.7071f));
+        assign(attack_shelf, highPass(500.0f, 0.5f));
+    }
+
+    void applyOverdrive(float& sample, float) override
+    {
+        float in = triode.processSample(sample);
+        float in_drive = in * drive_gain;
+        float ff1 = ff1_lpf.processSample(in);
+        float ff2 = ff2_lpf.processSample(ff2_hpf.processSample(in_drive) + in);
+        float hpfed = pre_hpf.processSample(in_drive);
+        float lpfed = pre_lpf.processSample(hpfed);
+        float shaped = attack_shelf.processSample(lpfed);
+        float distorded = diode.processSample(shaped);
+        sample = distorded + 0.15f * ff1 + 0.10f * ff2;
+    }
+};
+
+struct ChainBorealis
+{
+    Triode<Tube12AX7> triode{sample_rate};
+    Biquad ff1_lpf, ff2_hpf, ff2_lpf;
+    Chain<Biquad, Biquad, Biquad, GermaniumDiode> distortion;
+    float drive_gain = 2.0f;
+
+    ChainBorealis()
+    {
+        assign(ff1_lpf, lowPass(106.0f, 0.7071f));
+        assign(ff2_hpf, lowPass(153.0f, 0.7071f));
+        assign(ff2_lpf, lowPass(272.0f, 0.7071f));
+        assign(distortion.get<0>(), highPass(129.0f, 0.7071f));
+        assign(distortion.get<1>(), lowPass(967.0f, 0.7071f));
+        assign(distortion.get<2>(), highPass(500.0f, 0.5f));
+        distortion.get<3>() = GermaniumDiode(sample_rate);
+    }
+
+    void process(float* samples, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            float in = triode.processSample(samples[i]);
+            float in_drive = in * drive_gain;
+            float ff1 = ff1_lpf.processSample(in);
+            float ff2 =
+                ff2_lpf.processSample(ff2_hpf.processSample(in_drive) + in);
+            samples[i] = distortion.processSample(in_drive) + 0.15f * ff1 +
+                         0.10f * ff2;
+        }
+    }
+};
+
+// Branches packed one per lane of ParallelBiquad, as BorealisOverdrive
+struct PackedBorealis
+{
+    Triode<Tube12AX7> triode{sample_rate};
+    ParallelBiquad branches[3];
+    GermaniumDiode diode{sample_rate};
+    float drive_gain = 2.0f;
+
+    static void assign(ParallelBiquad& layer, int lane, std::vector<float> c)
+    {
+        layer.setLane(lane, c[0], c[1], c[2], c[3], c[4]);
+    }
+
+    PackedBorealis()
+    {
+        assign(branches[0], 0, lowPass(106.0f, 0.7071f));
+        assign(branches[0], 1, lowPass(153.0f, 0.7071f));
+        assign(branches[1], 1, lowPass(272.0f, 0.7071f));
+        assign(branches[0], 2, highPass(129.0f, 0.7071f));
+        assign(branches[1], 2, lowPass(967.0f, 0.7071f));
+        assign(branches[2], 2, highPass(500.0f, 0.5f));
+    }
+
+    void process(float* samples, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            float in = triode.processSample(samples[i]);
+            float in_drive = in * drive_gain;
+            simd::vfloat4 y = branches[0].processSample(
+                simd::set4(in, in_drive, in_drive, 0.0f)
+            );
+            y = branches[1].processSample(
+                y + simd::set4(0.0f, in, 0.0f, 0.0f)
+            );
+            y = branches[2].processSample(y);
+            float lanes[4];
+            simd::store4(lanes, y);
+            samples[i] = diode.processSample(lanes[2]) + 0.15f * lanes[0] +
+                         0.10f * lanes[1];
+        }
+    }
+};
+
+// ns per sample, best of a few runs over fresh instances
+template <typename T> double measure(std::vector<float>& output)
+{
+    const int n = 1 << 16;
+    std::vector<float> input(n);
+    for (int i = 0; i < n; ++i)
+        input[i] = 0.5f * std::sin(2.0f * 3.14159265f * 220.0f * i / 88200.0f);
+
+    double best = 1e30;
+    for (int run = 0; run < 7; ++run)
+    {
+        auto core = std::make_unique<T>();
+        output = input;
+        auto start = std::chrono::steady_clock::now();
+        core->process(output.data(), n);
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(
+            best, std::chrono::duration<double, std::nano>(end - start).count()
+        );
+    }
+    return best / n;
+}
+
+double maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    double difference = 0.0;
+    for (size_t i = 0; i < a.size(); ++i)
+        difference = std::max(difference, double(std::abs(a[i] - b[i])));
+    return difference;
+}
+} // namespace
+
+int main()
+{
+    std::vector<float> member_out, chain_out;
+    bool ok = true;
+
+    double member = measure<MemberHelios>(member_out);
+    double chain = measure<ChainHelios>(chain_out);
+    double difference = maxDifference(member_out, chain_out);
+    ok = ok && difference < 1e-4;
+    std::printf("helios    member %6.2f ns, chain %6.2f ns, x%.2f, diff %.2g\n",
+                member, chain, member / chain, difference);
+
+    member = measure<MemberBorealis>(member_out);
+    chain = measure<ChainBorealis>(chain_out);
+    difference = maxDifference(member_out, chain_out);
+    ok = ok && difference < 1e-4;
+    std::printf("borealis  member %6.2f ns, chain %6.2f ns, x%.2f, diff %.2g\n",
+                member, chain, member / chain, difference);
+
+    double packed = measure<PackedBorealis>(chain_out);
+    difference = maxDifference(member_out, chain_out);
+    ok = ok && difference < 1e-4;
+    std::printf("borealis  member %6.2f ns, packed %5.2f ns, x%.2f, diff %.2g\n",
+                member, packed, member / packed, difference);
+
+    return ok ? 0 : 1;
+}
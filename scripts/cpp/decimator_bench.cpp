@@ -0,0 +1,334 @@
+// Cost of FusedDecimator (src/dsp/filters/fused_decimator.h) against the
+// decimation it replaced in the overdrives: the post low-pass biquad and
+// juce::dsp::Oversampling's half band polyphase IIR stages, stood in for
+// here with the same design (FilterDesign's polyphase allpass method, at
+// the transition widths and attenuations Oversampling picks at maximum
+// quality) and the same per sample loop.
+//
+// Build and run from the repository root:
+//   g++ -O2 -std=c++17 -Isrc -Iscripts/cpp/stand_in
+//       -o scripts/decimator_bench scripts/cpp/decimator_bench.cpp
+//       src/dsp/filters/fused_decimator.cpp
+//   ./scripts/decimator_bench
+//
+// Prints ns per output sample for each overdrive core, and the worst gain
+// of each decimator over the band that folds back into the pass band. The
+// exit status is non-zero when a fused decimator aliases above the floor
+// set for its overdrive.
+
+#include "dsp/filters/fused_decimator.h"
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace
+{
+const double pi = 3.14159265358979323846;
+const double base_rate = 48000.0;
+const int block_size = 64;
+
+// FilterDesign::designIIRLowpassHalfBandPolyphaseAllpassMethod
+std::vector<float> halfBandCoefficients(double transitionWidth, double dB)
+{
+    double wt = 2.0 * pi * transitionWidth;
+    double ds = std::pow(10.0, dB / 20.0);
+    double k = std::pow(std::tan((pi - wt) / 4.0), 2.0);
+    double kp = std::sqrt(1.0 - k * k);
+    double e = (1.0 - std::sqrt(kp)) / (1.0 + std::sqrt(kp)) * 0.5;
+    double q = e + 2.0 * std::pow(e, 5.0) + 15.0 * std::pow(e, 9.0) +
+               150.0 * std::pow(e, 13.0);
+    double k1 = ds * ds / (1.0 - ds * ds);
+    int n = static_cast<int>(std::ceil(std::log(k1 * k1 / 16.0) / std::log(q)));
+    if (n % 2 == 0)
+        ++n;
+    if (n == 1)
+        n = 3;
+
+    std::vector<double> a;
+    for (int i = 1; i <= (n - 1) / 2; ++i)
+    {
+        double num = 0.0;
+        double delta = 1.0;
+        for (int m = 0; std::abs(delta) > 1e-100; ++m)
+        {
+            delta = std::pow(-1.0, m) * std::pow(q, m * (m + 1)) *
+                    std::sin((2 * m + 1) * pi * i / n);
+            num += delta;
+        }
+        num *= 2.0 * std::pow(q, 0.25);
+        double den = 0.0;
+        delta = 1.0;
+        for (int m = 1; std::abs(delta) > 1e-100; ++m)
+        {
+            delta = std::pow(-1.0, m) * std::pow(q, m * m) *
+                    std::cos(2.0 * pi * m * i / n);
+            den += delta;
+        }
+        den = 1.0 + 2.0 * den;
+        double w = num / den;
+        double ap = std::sqrt((1.0 - w * w * k) * (1.0 - w * w / k)) /
+                    (1.0 + w * w);
+        a.push_back((1.0 - ap) / (1.0 + ap));
+    }
+
+    // Even ones on the direct path first, then the odd ones
+    std::vector<float> ordered;
+    for (size_t i = 0; i < a.size(); i += 2)
+        ordered.push_back(static_cast<float>(a[i]));
+    for (size_t i = 1; i < a.size(); i += 2)
+        ordered.push_back(static_cast<float>(a[i]));
+    return ordered;
+}
+
+// Oversampling2TimesPolyphaseIIR::processSamplesDown
+class HalfBandStage
+{
+  public:
+    HalfBandStage(double transitionWidth, double dB)
+        : coefficients(halfBandCoefficients(transitionWidth, dB)),
+          state(coefficients.size(), 0.0f)
+    {
+    }
+
+    void process(const float* input, float* output, int numOutputSamples)
+    {
+        const int num_stages = static_cast<int>(coefficients.size());
+        const int direct_stages = num_stages - num_stages / 2;
+        for (int i = 0; i < numOutputSamples; ++i)
+        {
+            float sample = input[i << 1];
+            for (int n = 0; n < direct_stages; ++n)
+            {
+                float alpha = coefficients[(size_t)n];
+                float out = alpha * sample + state[(size_t)n];
+                state[(size_t)n] = sample - alpha * out;
+                sample = out;
+            }
+            float direct = sample;
+
+            sample = input[(i << 1) + 1];
+            for (int n = direct_stages; n < num_stages; ++n)
+            {
+                float alpha = coefficients[(size_t)n];
+                float out = alpha * sample + state[(size_t)n];
+                state[(size_t)n] = sample - alpha * out;
+                sample = out;
+            }
+            output[i] = (delay + direct) * 0.5f;
+            delay = sample;
+        }
+    }
+
+  private:
+    std::vector<float> coefficients;
+    std::vector<float> state;
+    float delay = 0.0f;
+};
+
+// Transposed direct form II, as juce::dsp::IIR::Filter runs a biquad
+class Biquad
+{
+  public:
+    Biquad(double sampleRate, double frequency, double q)
+    {
+        auto c = juce::dsp::IIR::Coefficients<float>::makeLowPass(
+            sampleRate, static_cast<float>(frequency), static_cast<float>(q)
+        );
+        for (int i = 0; i < 5; ++i)
+            coefficients[i] = static_cast<float>(c->c[i]);
+    }
+
+    void process(float* samples, int numSamples)
+    {
+        const float* c = coefficients;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float x = samples[i];
+            float y = c[0] * x + s1;
+            s1 = c[1] * x - c[3] * y + s2;
+            s2 = c[2] * x - c[4] * y;
+            samples[i] = y;
+        }
+    }
+
+  private:
+    float coefficients[5];
+    float s1 = 0.0f;
+    float s2 = 0.0f;
+};
+
+struct Core
+{
+    const char* name;
+    int factor;
+    double post_cutoff;
+    double post_q;
+    // Rate the post low-pass is voiced at, relative to the base rate
+    double post_design_ratio;
+    // Whether the old post low-pass ran at the oversampled rate
+    bool post_oversampled;
+    // As the overdrive prepares its decimator
+    int taps;
+    double stop_band_db;
+    // Worst alias the fused decimator may leave
+    double alias_floor_db;
+};
+
+// Runs a decimator over blocks of a noise signal, returns ns per output
+// sample, best of a few runs
+double time(const std::function<void(const float*, float*)>& decimate,
+            int factor)
+{
+    const int num_blocks = 2000;
+    std::vector<float> input(static_cast<size_t>(block_size * factor));
+    unsigned seed = 1;
+    for (float& x : input)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        x = static_cast<float>(seed >> 8) / 8388608.0f - 1.0f;
+    }
+    std::vector<float> output(block_size);
+    double best = 1e30;
+    float sink = 0.0f;
+    for (int run = 0; run < 5; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int b = 0; b < num_blocks; ++b)
+        {
+            decimate(input.data(), output.data());
+            sink += output[(size_t)(b % block_size)];
+        }
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(
+            best, std::chrono::duration<double, std::nano>(end - start).count()
+        );
+    }
+    if (sink == 1234.5f)
+        std::printf(" ");
+    return best / (static_cast<double>(num_blocks) * block_size);
+}
+
+// Worst gain in dB of a decimator over the inputs that fold back below
+// 0.42 of the output rate, from sines swept above the stop band edge
+double worstAlias(const std::function<void(const float*, float*)>& decimate,
+                  int factor)
+{
+    const double input_rate = base_rate * factor;
+    const int settle = 64;
+    const int measure = 64;
+    std::vector<float> input(static_cast<size_t>(block_size * factor));
+    std::vector<float> output(block_size);
+    double worst = 0.0;
+    for (double f = 0.58 * base_rate; f < 0.5 * input_rate;
+         f += 0.0025 * base_rate)
+    {
+        double peak = 0.0;
+        int n = 0;
+        for (int b = 0; b < settle + measure; ++b)
+        {
+            for (int i = 0; i < block_size * factor; ++i, ++n)
+                input[(size_t)i] =
+                    static_cast<float>(std::sin(2.0 * pi * f * n / input_rate));
+            decimate(input.data(), output.data());
+            if (b >= settle)
+                for (float y : output)
+                    peak = std::max(peak, std::abs(static_cast<double>(y)));
+        }
+        worst = std::max(worst, peak);
+    }
+    return 20.0 * std::log10(std::max(worst, 1e-12));
+}
+} // namespace
+
+int main()
+{
+    const std::vector<Core> cores = {
+        // Helios at the level of the half band filters it replaced,
+        // Borealis as low as its clipping is antialiased
+        {"Helios, 4x", 4, 3400.0, 0.7071067811865476, 2.0, false, 128,
+         -100.0, -74.0},
+        {"Helios, 2x", 2, 3400.0, 0.7071067811865476, 1.0, false, 64, -100.0,
+         -74.0},
+        {"Borealis, 2x", 2, 3400.0, 0.57, 1.0, true, 192, -120.0, -100.0},
+    };
+    bool below_floor = true;
+
+    std::printf("%.0f Hz, blocks of %d, ns per output sample\n\n", base_rate,
+                block_size);
+    std::printf("  %-14s %5s %10s %10s %14s %14s %12s\n", "core", "taps",
+                "fused", "previous", "fused alias", "previous alias",
+                "floor");
+
+    for (const Core& core : cores)
+    {
+        const double input_rate = base_rate * core.factor;
+        const double design_rate = base_rate * core.post_design_ratio;
+
+        auto make_fused = [&]()
+        {
+            auto fused = std::make_shared<FusedDecimator>();
+            fused->prepare(
+                base_rate, core.factor, core.taps, core.stop_band_db,
+                block_size
+            );
+            fused->setPostFilter(
+                juce::dsp::IIR::Coefficients<float>::makeLowPass(
+                    design_rate, static_cast<float>(core.post_cutoff),
+                    static_cast<float>(core.post_q)
+                )
+            );
+            return [fused](const float* in, float* out)
+            { fused->process(in, out, block_size); };
+        };
+
+        auto make_previous = [&]()
+        {
+            // Oversampling stage n runs between 2^n and 2^(n+1) times the
+            // base rate, the last stage decimates first
+            auto stages = std::make_shared<std::vector<HalfBandStage>>();
+            for (int n = 0; (1 << n) < core.factor; ++n)
+                stages->emplace_back(n == 0 ? 0.06 : 0.12, -70.0 + 10.0 * n);
+            double post_rate = core.post_oversampled ? input_rate : base_rate;
+            auto post = std::make_shared<Biquad>(
+                post_rate, core.post_cutoff, core.post_q
+            );
+            auto scratch = std::make_shared<std::vector<float>>(
+                static_cast<size_t>(block_size * core.factor)
+            );
+            bool post_oversampled = core.post_oversampled;
+            int factor = core.factor;
+            return [=](const float* in, float* out)
+            {
+                std::copy(in, in + block_size * factor, scratch->data());
+                float* x = scratch->data();
+                if (post_oversampled)
+                    post->process(x, block_size * factor);
+                int length = block_size * factor;
+                for (auto stage = stages->rbegin(); stage != stages->rend();
+                     ++stage)
+                {
+                    length /= 2;
+                    stage->process(x, length == block_size ? out : x, length);
+                }
+                if (!post_oversampled)
+                    post->process(out, block_size);
+            };
+        };
+
+        double fused_ns = time(make_fused(), core.factor);
+        double previous_ns = time(make_previous(), core.factor);
+        double fused_alias = worstAlias(make_fused(), core.factor);
+        double previous_alias = worstAlias(make_previous(), core.factor);
+        bool ok = fused_alias <= core.alias_floor_db;
+        below_floor = below_floor && ok;
+        std::printf("  %-14s %5d %10.2f %10.2f %11.1f dB %11.1f dB",
+                    core.name, core.taps, fused_ns, previous_ns, fused_alias,
+                    previous_alias);
+        std::printf(" %6.1f dB %s\n", core.alias_floor_db, ok ? "ok" : "ABOVE");
+    }
+    return below_floor ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// Accuracy check of src/dsp/maths/fast_math.h against the standard library,
+// scalar and SIMD forms. Exits with a non-zero status when a function goes
+// over the error bound declared in the header, so it can gate changes.
+//
+// Build and run from the repository root:
+//   g++ -O2 -std=c++17 -Isrc -o scripts/fast_math_check
+//       scripts/cpp/fast_math_check.cpp
+//   ./scripts/fast_math_check
+
+#include "dsp/maths/fast_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace
+{
+struct Check
+{
+    const char* name;
+    double low;
+    double high;
+    bool relative;
+    double bound;
+    std::function<float(float)> scalar;
+    std::function<simd::vfloat(simd::vfloat)> vector;
+    std::function<double(double)> reference;
+};
+
+double error(const Check& check, double value, double reference)
+{
+    double e = std::abs(value - reference);
+    if (check.relative)
+        e /= std::max(std::abs(reference), 1e-30);
+    return e;
+}
+
+bool run(const Check& check)
+{
+    const int n = 1 << 16;
+    std::vector<float> x(n);
+    for (int i = 0; i < n; ++i)
+        x[i] = static_cast<float>(
+            check.low + (check.high - check.low) * i / (n - 1.0)
+        );
+
+    double worst = 0.0;
+    double worst_x = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        // The reference takes the float argument, not the ideal one
+        double reference = check.reference(x[i]);
+        double e = error(check, check.scalar(x[i]), reference);
+        if (e > worst)
+        {
+            worst = e;
+            worst_x = x[i];
+        }
+    }
+
+    double vector_worst = 0.0;
+    float lanes[simd::width];
+    for (int i = 0; i + simd::width <= n; i += simd::width)
+    {
+        simd::store(lanes, check.vector(simd::load(&x[i])));
+        for (int l = 0; l < simd::width; ++l)
+        {
+            vector_worst = std::max(
+                vector_worst, error(check, lanes[l], check.reference(x[i + l]))
+            );
+        }
+    }
+
+    bool ok = worst <= check.bound && vector_worst <= check.bound;
+    std::printf(
+        "%-5s %-16s [%8g, %8g] %s %.3e (at %g), simd %.3e, bound %.1e\n",
+        ok ? "ok" : "FAIL", check.name, check.low, check.high,
+        check.relative ? "rel" : "abs", worst, worst_x, vector_worst,
+        check.bound
+    );
+    return ok;
+}
+
+#define FAST(f) [](float v) { return fast_math::f(v); }
+#define FAST_SIMD(f) [](simd::vfloat v) { return fast_math::f(v); }
+} // namespace
+
+int main()
+{
+    using namespace fast_math;
+    const std::vector<Check> checks = {
+        {"exp2", -126.0, 127.0, true, exp2_max_relative_error, FAST(exp2),
+         FAST_SIMD(exp2), [](double v) { return std::exp2(v); }},
+        {"exp", -80.0, 80.0, true, exp_max_relative_error, FAST(exp),
+         FAST_SIMD(exp), [](double v) { return std::exp(v); }},
+        {"log2", 1e-9, 1e9, false, log2_max_error, FAST(log2), FAST_SIMD(log2),
+         [](double v) { return std::log2(v); }},
+        {"log2 near 1", 0.5, 2.0, false, log2_max_error, FAST(log2),
+         FAST_SIMD(log2), [](double v) { return std::log2(v); }},
+        {"log10", 1e-6, 1e6, false, log2_max_error, FAST(log10),
+         FAST_SIMD(log10), [](double v) { return std::log10(v); }},
+        {"tanh", -20.0, 20.0, false, tanh_max_error, FAST(tanh),
+         FAST_SIMD(tanh), [](double v) { return std::tanh(v); }},
+        {"tanh near 0", -0.5, 0.5, false, tanh_max_error, FAST(tanh),
+         FAST_SIMD(tanh), [](double v) { return std::tanh(v); }},
+        {"decibelsToGain", -99.9, 48.0, true,
+         decibels_to_gain_max_relative_error,
+         FAST(decibelsToGain), FAST_SIMD(decibelsToGain),
+         [](double v) { return std::pow(10.0, v / 20.0); }},
+        {"gainToDecibels", 1e-5, 1e3, false, gain_to_decibels_max_error,
+         FAST(gainToDecibels), FAST_SIMD(gainToDecibels),
+         [](double v) { return 20.0 * std::log10(v); }},
+    };
+
+    bool ok = true;
+    for (const Check& check : checks)
+        ok = run(check) && ok;
+
+    // Edges the plugin relies on
+    ok = ok && fast_math::decibelsToGain(-100.0f) == 0.0f;
+    ok = ok && fast_math::gainToDecibels(0.0f) == minus_infinity_db;
+    ok = ok && fast_math::tanh(1e3f) == 1.0f && fast_math::tanh(-1e3f) == -1.0f;
+
+    std::printf(ok ? "all within bounds\n" : "out of bounds\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+// Accuracy and speed of the Wright omega approximations used by the diode
+// models, measured against the toms917 reference implementation.
+//
+// Build and run from the repository root:
+//   g++ -O2 -std=c++17 -Isrc -o scripts/omega_bench
+//       scripts/cpp/omega_bench.cpp src/dsp/maths/toms917.cpp
+//   ./scripts/omega_bench [tolerance, default 1e-2]
+//
+// First checks that the vector omega and the batched diode agree with the
+// scalar ones, the exit status is non-zero when they do not.
+// For each argument range, prints max / RMS error and ns per evaluation of
+// every candidate, the Pareto-optimal candidates (error against speed) and
+// the cheapest one within the error tolerance. Candidates are ranked on a
+// mixed error, |error| / max(1, omega): absolute where omega is small,
+// since the diode models scale it by the thermal voltage (~26 mV), and
+// relative where it grows with x.
+
+#include "dsp/circuits/germanium_diode.h"
+#include "dsp/maths/omega.h"
+#include "dsp/maths/toms917.h"
+#include "dsp/maths/wright_omega.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Range
+{
+    const char* name;
+    float low;
+    float high;
+};
+
+struct Candidate
+{
+    std::string name;
+    // Evaluates n arguments
+    std::function<void(const float*, float*, int)> evaluate;
+};
+
+struct Result
+{
+    std::string name;
+    double max_abs = 0.0;
+    double max_rel = 0.0;
+    double max_mixed = 0.0;
+    double rms = 0.0;
+    double ns = 0.0;
+};
+
+template <float (*f)(float)> Candidate scalar(const char* name)
+{
+    return {name, [](const float* x, float* y, int n)
+            {
+                for (int i = 0; i < n; ++i)
+                    y[i] = f(x[i]);
+            }};
+}
+
+float polynomial(float x)
+{
+    // The 5th order fit germanium_diode.h used around the origin
+    return 0.5671432904097838f + 0.3618963236098023f * x +
+           0.0736778463779836f * std::pow(x, 2.0f) -
+           0.0013437346889135f * std::pow(x, 3.0f) -
+           0.0016355437889344f * std::pow(x, 4.0f) +
+           0.0002166542734346f * std::pow(x, 5.0f);
+}
+
+float sharedScalar(float x)
+{
+    return omega(x);
+}
+
+float branchlessScalar(float x)
+{
+    return omega<float>(x);
+}
+
+Candidate sharedVector()
+{
+    return {"omega<vfloat>", [](const float* x, float* y, int n)
+            {
+                int i = 0;
+                for (; i + simd::width <= n; i += simd::width)
+                    simd::store(y + i, omega(simd::load(x + i)));
+                for (; i < n; ++i)
+                    y[i] = omega(x[i]);
+            }};
+}
+
+Result measure(
+    const Candidate& candidate, const std::vector<float>& x,
+    const std::vector<double>& reference
+)
+{
+    Result result;
+    result.name = candidate.name;
+    const int n = static_cast<int>(x.size());
+    std::vector<float> y(x.size());
+
+    candidate.evaluate(x.data(), y.data(), n);
+    double squares = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        double error = std::abs(static_cast<double>(y[i]) - reference[i]);
+        result.max_abs = std::max(result.max_abs, error);
+        result.max_rel =
+            std::max(result.max_rel, error / std::max(reference[i], 1e-30));
+        result.max_mixed =
+            std::max(result.max_mixed, error / std::max(reference[i], 1.0));
+        squares += error * error;
+    }
+    result.rms = std::sqrt(squares / n);
+
+    // Best of a few runs
+    const int repeats = 200;
+    double best = 1e30;
+    float sink = 0.0f;
+    for (int run = 0; run < 5; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            candidate.evaluate(x.data(), y.data(), n);
+            sink += y[r % n];
+        }
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(
+            best, std::chrono::duration<double, std::nano>(end - start).count()
+        );
+    }
+    result.ns = best / (static_cast<double>(repeats) * n);
+    if (sink == 1234.5f)
+        std::printf(" ");
+    return result;
+}
+
+// The vector paths against the scalar ones, lane by lane: omega<vfloat>
+// against omega(float), and GermaniumDiodeBatch against one GermaniumDiode
+// per channel on sines driven from below the conduction threshold to well
+// into clipping. Returns whether both agree within tolerance.
+bool checkAgreement(double tolerance)
+{
+    const int n = 1 << 16;
+    double omega_error = 0.0;
+    alignas(32) float lanes[simd::width];
+    for (int i = 0; i < n; i += simd::width)
+    {
+        for (int lane = 0; lane < simd::width; ++lane)
+            lanes[lane] = -40.0f + 1040.0f * (i + lane) / n;
+        alignas(32) float x[simd::width];
+        std::copy(lanes, lanes + simd::width, x);
+        simd::store(lanes, omega(simd::load(x)));
+        for (int lane = 0; lane < simd::width; ++lane)
+        {
+            double expected = omega(x[lane]);
+            omega_error = std::max(
+                omega_error, std::abs(lanes[lane] - expected) /
+                                 std::max(std::abs(expected), 1.0)
+            );
+        }
+    }
+
+    const float sample_rate = 96000.0f;
+    const int length = 8192;
+    std::vector<std::vector<float>> channels(simd::width);
+    std::vector<float*> pointers;
+    for (int channel = 0; channel < simd::width; ++channel)
+    {
+        float amplitude = 0.05f + 3.0f * channel / simd::width;
+        for (int i = 0; i < length; ++i)
+            channels[(size_t)channel].push_back(
+                amplitude * std::sin(0.0072f * (channel + 1) * i)
+            );
+        pointers.push_back(channels[(size_t)channel].data());
+    }
+    std::vector<std::vector<float>> expected = channels;
+    for (auto& samples : expected)
+    {
+        GermaniumDiode diode(sample_rate);
+        for (float& sample : samples)
+            sample = diode.processSample(sample);
+    }
+    GermaniumDiodeBatch batch(sample_rate);
+    batch.processBlock(pointers.data(), simd::width, length);
+    double diode_error = 0.0;
+    for (int channel = 0; channel < simd::width; ++channel)
+        for (int i = 0; i < length; ++i)
+            diode_error = std::max(
+                diode_error,
+                (double)std::abs(
+                    channels[(size_t)channel][(size_t)i] -
+                    expected[(size_t)channel][(size_t)i]
+                )
+            );
+
+    bool agree = omega_error <= tolerance && diode_error <= tolerance;
+    std::printf("scalar against vector: omega %.3e (mixed), diode %.3e V, "
+                "%s\n", omega_error, diode_error, agree ? "ok" : "FAILED");
+    return agree;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double tolerance = argc > 1 ? std::atof(argv[1]) : 1e-2;
+
+    const std::vector<Range> ranges = {
+        {"x < -3.34 (exponential tail)", -40.0f, -3.341459552768620f},
+        {"-3.34 <= x < -1.5", -3.341459552768620f, -1.5f},
+        {"|x| <= 1.5", -1.5f, 1.5f},
+        {"1.5 < x <= 8", 1.5f, 8.0f},
+        {"8 < x <= 1000", 8.0f, 1000.0f},
+    };
+    const std::vector<Candidate> candidates = {
+        scalar<omega1>("omega1"),
+        scalar<omega2>("omega2"),
+        scalar<omega3>("omega3"),
+        scalar<omega4>("omega4"),
+        scalar<polynomial>("polynomial"),
+        scalar<sharedScalar>("omega(float)"),
+        scalar<branchlessScalar>("omega<float>"),
+        sharedVector(),
+    };
+
+    std::printf("tolerance %g (mixed error), simd width %d\n", tolerance,
+                simd::width);
+    bool agree = checkAgreement(1e-5);
+
+    for (const Range& range : ranges)
+    {
+        const int n = 4096;
+        std::vector<float> x(n);
+        std::vector<double> reference(n);
+        for (int i = 0; i < n; ++i)
+        {
+            x[i] = range.low + (range.high - range.low) * (i + 0.5f) / n;
+            reference[i] = wrightomega_double(x[i]);
+        }
+
+        std::vector<Result> results;
+        for (const Candidate& candidate : candidates)
+            results.push_back(measure(candidate, x, reference));
+
+        std::printf("\n%s\n", range.name);
+        std::printf("  %-14s %10s %10s %10s %10s %8s\n", "candidate",
+                    "max abs", "max rel", "mixed", "rms", "ns/eval");
+        for (const Result& r : results)
+        {
+            std::printf("  %-14s %10.3e %10.3e %10.3e %10.3e %8.2f\n",
+                        r.name.c_str(), r.max_abs, r.max_rel, r.max_mixed,
+                        r.rms, r.ns);
+        }
+
+        std::printf("  pareto:");
+        for (const Result& r : results)
+        {
+            bool dominated = std::any_of(
+                results.begin(), results.end(),
+                [&r](const Result& o)
+                {
+                    return o.max_mixed <= r.max_mixed && o.ns <= r.ns &&
+                           (o.max_mixed < r.max_mixed || o.ns < r.ns);
+                }
+            );
+            if (!dominated)
+                std::printf(" %s", r.name.c_str());
+        }
+
+        const Result* choice = nullptr;
+        for (const Result& r : results)
+        {
+            if (r.max_mixed <= tolerance &&
+                (choice == nullptr || r.ns < choice->ns))
+                choice = &r;
+        }
+        std::printf("\n  choice: %s\n", choice ? choice->name.c_str() : "none");
+    }
+    return agree ? 0 : 1;
+}
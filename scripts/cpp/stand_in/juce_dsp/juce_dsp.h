@@ -0,0 +1,58 @@
+#pragma once
+
+// The part of juce_dsp that src/dsp/filters/fused_decimator.cpp uses, so
+// that the benches can build it without JUCE. Same formulas as JUCE.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <memory>
+
+#define jassert(expression) assert(expression)
+
+namespace juce
+{
+template <typename T> T jmax(T a, T b)
+{
+    return std::max(a, b);
+}
+
+namespace dsp
+{
+namespace IIR
+{
+template <typename T> struct Coefficients
+{
+    using Ptr = std::shared_ptr<Coefficients>;
+
+    // b0, b1, b2, a1, a2, normalised
+    double c[5];
+
+    static Ptr makeLowPass(
+        double sampleRate, T frequency, T q = T(0.7071067811865476)
+    )
+    {
+        double n = 1.0 / std::tan(3.14159265358979323846 * frequency /
+                                  sampleRate);
+        double n2 = n * n;
+        double c1 = 1.0 / (1.0 + n / q + n2);
+        auto coefficients = std::make_shared<Coefficients>();
+        *coefficients = {{c1, 2.0 * c1, c1, c1 * 2.0 * (1.0 - n2),
+                          c1 * (1.0 - n / q + n2)}};
+        return coefficients;
+    }
+
+    double getMagnitudeForFrequency(double frequency, double sampleRate) const
+    {
+        std::complex<double> z = std::polar(
+            1.0, -2.0 * 3.14159265358979323846 * frequency / sampleRate
+        );
+        return std::abs(
+            (c[0] + z * (c[1] + z * c[2])) / (1.0 + z * (c[3] + z * c[4]))
+        );
+    }
+};
+} // namespace IIR
+} // namespace dsp
+} // namespace juce
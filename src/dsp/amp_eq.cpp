@@ -6,58 +6,127 @@
 void AmpEQ::prepare(const juce::dsp::ProcessSpec& spec)
 {
     processSpec = spec;
-    bass_shelf.prepare(processSpec);
-    low_mid_peak.prepare(processSpec);
-    high_mid_peak.prepare(processSpec);
-    treble_peak.prepare(processSpec);
+    designed = false;
+    filters.reset();
 }
 
-void AmpEQ::setCoefficients()
+void AmpEQ::reset()
 {
-    if (!juce::approximatelyEqual(smoothed_bass_gain, bass_gain))
+    filters.reset();
+}
+
+bool AmpEQ::isSettled() const
+{
+    return juce::approximatelyEqual(smoothed_bass_gain, bass_gain) &&
+           juce::approximatelyEqual(smoothed_low_mid_gain, low_mid_gain) &&
+           juce::approximatelyEqual(smoothed_high_mid_gain, high_mid_gain) &&
+           juce::approximatelyEqual(smoothed_treble_gain, treble_gain);
+}
+
+void AmpEQ::applySettledResponse(
+    juce::AudioBuffer<float>& buffer, double sampleRate, const Gains& gains
+)
+{
+    BiquadCascade<4> settled;
+    settled.setSection(
+        0, rbj::lowShelf(
+               sampleRate, bass_shelf_frequency, bass_shelf_q, gains.bass
+           )
+    );
+    settled.setSection(
+        1, rbj::peak(
+               sampleRate, low_mid_peak_frequency, low_mid_peak_q,
+               gains.low_mid
+           )
+    );
+    settled.setSection(
+        2, rbj::peak(
+               sampleRate, high_mid_peak_frequency, high_mid_peak_q,
+               gains.high_mid
+           )
+    );
+    settled.setSection(
+        3, rbj::peak(
+               sampleRate, treble_peak_frequency, treble_peak_q, gains.treble
+           )
+    );
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    {
+        settled.reset();
+        settled.process(
+            buffer.getWritePointer(channel), buffer.getNumSamples()
+        );
+    }
+}
+
+void AmpEQ::setSmoothedGains(
+    float bass, float lowMid, float highMid, float treble
+)
+{
+    smoothed_bass_gain = bass;
+    smoothed_low_mid_gain = lowMid;
+    smoothed_high_mid_gain = highMid;
+    smoothed_treble_gain = treble;
+}
+
+void AmpEQ::setCoefficients(int numSamples)
+{
+    // Takes the smoothed gain when the filter has to follow it
+    auto update = [this](float& designedGain, float smoothedGain)
     {
-        smoothed_bass_gain +=
-            (bass_gain - smoothed_bass_gain) * smoothing_factor;
-        auto bass_shelf_coefficients =
-            juce::dsp::IIR::Coefficients<float>::makeLowShelf(
-                processSpec.sampleRate, bass_shelf_frequency, bass_shelf_q,
-                smoothed_bass_gain
-            );
-        *bass_shelf.coefficients = *bass_shelf_coefficients;
+        if (designed && juce::approximatelyEqual(designedGain, smoothedGain))
+            return false;
+        designedGain = smoothedGain;
+        return true;
+    };
+
+    bool moved = false;
+    if (update(designed_bass_gain, smoothed_bass_gain))
+    {
+        filters.setTarget(
+            0, rbj::lowShelf(
+                   processSpec.sampleRate, bass_shelf_frequency, bass_shelf_q,
+                   designed_bass_gain
+               )
+        );
+        moved = true;
     }
-    if (!juce::approximatelyEqual(smoothed_low_mid_gain, low_mid_gain))
+    if (update(designed_low_mid_gain, smoothed_low_mid_gain))
     {
-        smoothed_low_mid_gain +=
-            (low_mid_gain - smoothed_low_mid_gain) * smoothing_factor;
-        auto low_mid_peak_coefficients =
-            juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-                processSpec.sampleRate, low_mid_peak_frequency, low_mid_peak_q,
-                smoothed_low_mid_gain
-            );
-        *low_mid_peak.coefficients = *low_mid_peak_coefficients;
+        filters.setTarget(
+            1, rbj::peak(
+                   processSpec.sampleRate, low_mid_peak_frequency,
+                   low_mid_peak_q, designed_low_mid_gain
+               )
+        );
+        moved = true;
     }
-    if (!juce::approximatelyEqual(smoothed_high_mid_gain, high_mid_gain))
+    if (update(designed_high_mid_gain, smoothed_high_mid_gain))
     {
-        smoothed_high_mid_gain +=
-            (high_mid_gain - smoothed_high_mid_gain) * smoothing_factor;
-        auto high_mid_peak_coefficients =
-            juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-                processSpec.sampleRate, high_mid_peak_frequency,
-                high_mid_peak_q, smoothed_high_mid_gain
-            );
-        *high_mid_peak.coefficients = *high_mid_peak_coefficients;
+        filters.setTarget(
+            2, rbj::peak(
+                   processSpec.sampleRate, high_mid_peak_frequency,
+                   high_mid_peak_q, designed_high_mid_gain
+               )
+        );
+        moved = true;
     }
-    if (!juce::approximatelyEqual(smoothed_treble_gain, treble_gain))
+    if (update(designed_treble_gain, smoothed_treble_gain))
     {
-        smoothed_treble_gain +=
-            (treble_gain - smoothed_treble_gain) * smoothing_factor;
-        auto treble_peak_coefficients =
-            juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-                processSpec.sampleRate, treble_peak_frequency, treble_peak_q,
-                smoothed_treble_gain
-            );
-        *treble_peak.coefficients = *treble_peak_coefficients;
+        filters.setTarget(
+            3, rbj::peak(
+                   processSpec.sampleRate, treble_peak_frequency,
+                   treble_peak_q, designed_treble_gain
+               )
+        );
+        moved = true;
     }
+    // Interpolated across the block instead of stepping at its start, the
+    // first design after prepare() is immediate
+    if (moved)
+        filters.glide(designed ? numSamples : 0);
+    designed = true;
 }
 
 void AmpEQ::process(juce::AudioBuffer<float>& buffer)
@@ -66,23 +135,12 @@ void AmpEQ::process(juce::AudioBuffer<float>& buffer)
     {
         return;
     }
-    float sampleRate = static_cast<float>(processSpec.sampleRate);
-    setCoefficients();
-
-    auto* channelData = buffer.getWritePointer(0);
-    for (int i = 0; i < buffer.getNumSamples(); ++i)
-    {
-        float sample = channelData[i];
-        applyEQ(sample, sampleRate);
-        channelData[i] = sample;
-    }
+    setCoefficients(buffer.getNumSamples());
+    filters.process(buffer.getWritePointer(0), buffer.getNumSamples());
 }
 
 void AmpEQ::applyEQ(float& sample, float sampleRate)
 {
     juce::ignoreUnused(sampleRate);
-    sample = bass_shelf.processSample(sample);
-    sample = low_mid_peak.processSample(sample);
-    sample = high_mid_peak.processSample(sample);
-    sample = treble_peak.processSample(sample);
+    sample = filters.processSample(sample);
 }
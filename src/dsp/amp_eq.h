@@ -1,14 +1,48 @@
 #pragma once
 
+#include "filters/biquad_cascade.h"
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
 
 class AmpEQ
 {
   public:
+    // Linear gains of the four bands
+    struct Gains
+    {
+        float bass = 1.0f;
+        float low_mid = 1.0f;
+        float high_mid = 1.0f;
+        float treble = 1.0f;
+    };
+
     void prepare(const juce::dsp::ProcessSpec& spec);
     void process(juce::AudioBuffer<float>& buffer);
     void applyEQ(float& sample, float sampleRate);
+    void reset();
+
+    // The bass shelf rings the longest, 60 dB down after ln(1000) of its
+    // time constants 2 q / w
+    double getTailSeconds() const
+    {
+        return 6.91 * 2.0 * bass_shelf_q /
+               (juce::MathConstants<double>::twoPi * bass_shelf_frequency);
+    }
+
+    // True once the smoothed gains have reached their targets, the EQ is
+    // then linear and time invariant.
+    bool isSettled() const;
+    // The gains the EQ settles to, copied on the thread that sets them
+    Gains getGains() const
+    {
+        return {bass_gain, low_mid_gain, high_mid_gain, treble_gain};
+    }
+    // Filters a buffer with the response of the EQ at the given gains,
+    // used to bake the EQ into an impulse response off the audio thread.
+    static void applySettledResponse(
+        juce::AudioBuffer<float>& buffer, double sampleRate,
+        const Gains& gains
+    );
 
     void setBassGain(float gain)
     {
@@ -30,27 +64,37 @@ class AmpEQ
     {
         bypass = shouldBypass;
     }
+    bool isBypassed() const
+    {
+        return bypass;
+    }
 
-    void setCoefficients();
+    // Gains the filters follow, the setters above give the targets the EQ
+    // settles to
+    void setSmoothedGains(
+        float bass, float lowMid, float highMid, float treble
+    );
+    // Glides the filters to the smoothed gains over the next numSamples
+    // samples
+    void setCoefficients(int numSamples);
 
   private:
     juce::dsp::ProcessSpec processSpec{-1, 0, 0};
 
-    juce::dsp::IIR::Filter<float> bass_shelf;
-    float bass_shelf_frequency = 100.0f;
-    float bass_shelf_q = 0.707f;
+    // bass shelf, low mid, high mid and treble peaks
+    BiquadCascade<4> filters;
+
+    static constexpr float bass_shelf_frequency = 100.0f;
+    static constexpr float bass_shelf_q = 0.707f;
 
-    juce::dsp::IIR::Filter<float> low_mid_peak;
-    float low_mid_peak_frequency = 500.0f;
-    float low_mid_peak_q = 0.707f;
+    static constexpr float low_mid_peak_frequency = 500.0f;
+    static constexpr float low_mid_peak_q = 0.707f;
 
-    juce::dsp::IIR::Filter<float> high_mid_peak;
-    float high_mid_peak_frequency = 1500.0f;
-    float high_mid_peak_q = 0.707f;
+    static constexpr float high_mid_peak_frequency = 1500.0f;
+    static constexpr float high_mid_peak_q = 0.707f;
 
-    juce::dsp::IIR::Filter<float> treble_peak;
-    float treble_peak_frequency = 5000.0f;
-    float treble_peak_q = 0.707f;
+    static constexpr float treble_peak_frequency = 5000.0f;
+    static constexpr float treble_peak_q = 0.707f;
 
     // GUI Parameters
     bool bypass = false;
@@ -66,6 +110,10 @@ class AmpEQ
     float smoothed_high_mid_gain = 1.0f;
     float smoothed_treble_gain = 1.0f;
 
-    // Interal parameters
-    float smoothing_factor = 0.1f;
+    // Gains the filters were last designed for
+    bool designed = false;
+    float designed_bass_gain = 1.0f;
+    float designed_low_mid_gain = 1.0f;
+    float designed_high_mid_gain = 1.0f;
+    float designed_treble_gain = 1.0f;
 };
@@ -1,5 +1,5 @@
 #pragma once
-#include "../maths/omega.h"
+#include "../maths/wright_omega.h"
 #include <cmath>
 
 class BJT
@@ -7,7 +7,6 @@ class BJT
   public:
     BJT() {};
     float processSample(float);
-    float omega(float);
 
   private:
     // Fixed variables
@@ -19,26 +18,6 @@ class BJT
     float k = std::log((i_s * re / vt) * (1 + 1 / beta_f));
 };
 
-inline float BJT::omega(float x)
-{
-    if (std::abs(x) > 1.5f)
-    {
-        return omega4(x);
-    }
-    else
-    {
-        float c0 = 0.5671432904097838f;
-        float c1 = 0.3618963236098023f;
-        float c2 = 0.0736778463779836f;
-        float c3 = -0.0013437346889135f;
-        float c4 = -0.0016355437889344f;
-        float c5 = 0.0002166542734346f;
-
-        return c0 + c1 * x + c2 * std::pow(x, 2.0f) + c3 * std::pow(x, 3.0f) +
-               c4 * std::pow(x, 4.0f) + c5 * std::pow(x, 5.0f);
-    }
-}
-
 inline float BJT::processSample(float s)
 {
     float vref = vp / 2;
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Series of stages composed at compile time. A stage is any type with a
+// float processSample(float). The stages are held by value in one struct
+// and called without indirection, so the compiler sees, and can inline,
+// the whole per-sample path.
+//
+//   Chain<Triode<Tube12AX7>, DCBlock, Gain, Triode<Tube12AX7>, DCBlock>
+template <typename... Stages> class Chain
+{
+  public:
+    static constexpr std::size_t size = sizeof...(Stages);
+
+    template <std::size_t I> auto& get()
+    {
+        return std::get<I>(stages);
+    }
+
+    template <std::size_t I> const auto& get() const
+    {
+        return std::get<I>(stages);
+    }
+
+    float processSample(float sample)
+    {
+        return processSample(sample, std::index_sequence_for<Stages...>{});
+    }
+
+    void process(float* samples, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] = processSample(samples[i]);
+    }
+
+    // Resets the stages that have a reset()
+    void reset()
+    {
+        reset(std::index_sequence_for<Stages...>{});
+    }
+
+  private:
+    template <typename T, typename = void>
+    struct HasReset : std::false_type
+    {
+    };
+    template <typename T>
+    struct HasReset<T, std::void_t<decltype(std::declval<T&>().reset())>>
+        : std::true_type
+    {
+    };
+
+    template <std::size_t... I>
+    float processSample(float sample, std::index_sequence<I...>)
+    {
+        ((sample = std::get<I>(stages).processSample(sample)), ...);
+        return sample;
+    }
+
+    template <std::size_t... I> void reset(std::index_sequence<I...>)
+    {
+        (resetStage(std::get<I>(stages)), ...);
+    }
+
+    template <typename Stage> static void resetStage(Stage& stage)
+    {
+        if constexpr (HasReset<Stage>::value)
+            stage.reset();
+    }
+
+    std::tuple<Stages...> stages;
+};
+
+// Multiplies by a gain set per block
+class Gain
+{
+  public:
+    void setGain(float newGain)
+    {
+        gain = newGain;
+    }
+
+    float processSample(float sample) const
+    {
+        return gain * sample;
+    }
+
+  private:
+    float gain = 1.0f;
+};
@@ -1,15 +1,51 @@
 #pragma once
-#include "../maths/omega.h"
-#include "../maths/toms917.h"
+#include "../maths/simd.h"
+#include "../maths/wright_omega.h"
+#include <algorithm>
 #include <cmath>
 
 class GermaniumDiode
 {
   public:
-    GermaniumDiode(float fs);
+    GermaniumDiode(float fs = 44100.0f);
     float processSample(float);
 
+    // The capacitor state cancels out of the update, k6 = b1 - a1 * b0 is
+    // zero, so the diode is a memoryless map of its input. shape() is that
+    // map, the same as processSample(). The double precision versions
+    // refine omega to full precision: they and the first and second
+    // antiderivatives are smooth enough for difference quotients.
+    float shape(float vin) const;
+    double preciseShape(double vin) const;
+    double shapeIntegral(double vin) const;
+    double shapeIntegral2(double vin) const;
+
+    // Diode solve and state update, F is float or simd::vfloat. Shared by
+    // processSample(), shape() and GermaniumDiodeBatch.
+    template <typename F> F solve(F vin, F& state) const;
+    float getState() const
+    {
+        return prev_p;
+    }
+
   private:
+    // Below it the diode does not conduct and the input goes through
+    static constexpr float linear_range = 0.1f;
+
+    // Antiderivatives of the conducting solution for one sign, up to a
+    // constant. With s the sign of q = k1 * vin, w = k2 * q + k3 * s and
+    // o = omega(k4 * s * w + k5), the solution is w - v_t * s * o and
+    // dq = v_t * s / k2 * (1 + 1 / o) do, which gives closed forms.
+    struct Conducting
+    {
+        double s;
+        double w;
+        double o;
+    };
+    Conducting conducting(double vin) const;
+    double conductingIntegral(double vin) const;
+    double conductingIntegral2(double vin) const;
+
     // Fixed variables
     float c = 1e-8;
     float r = 2200;
@@ -35,28 +71,13 @@ class GermaniumDiode
     float k4;
     float k5;
     float k6;
-};
 
-inline float omega(float x)
-{
-    if (std::abs(x) > 1.5f)
-    {
-        return omega4(x);
-    }
-    else
-    {
-        float c0 = 0.5671432904097838f;
-        float c1 = 0.3618963236098023f;
-        float c2 = 0.0736778463779836f;
-        float c3 = -0.0013437346889135f;
-        float c4 = -0.0016355437889344f;
-        float c5 = 0.0002166542734346f;
-
-        return c0 + c1 * x + c2 * std::pow(x, 2.0f) + c3 * std::pow(x, 3.0f) +
-               c4 * std::pow(x, 4.0f) + c5 * std::pow(x, 5.0f);
-        // return static_cast<float>(wrightomega_double(x));
-    }
-}
+    // Join the antiderivatives to the ones of the linear range, for
+    // positive [0] and negative [1] inputs
+    double integral_offset[2];
+    double integral2_slope[2];
+    double integral2_offset[2];
+};
 
 inline GermaniumDiode::GermaniumDiode(float t_fs)
 {
@@ -76,6 +97,17 @@ inline GermaniumDiode::GermaniumDiode(float t_fs)
 
     prev_v = 1.0f;
     prev_p = k6 * prev_v;
+
+    for (int side = 0; side < 2; ++side)
+    {
+        double edge = side == 0 ? linear_range : -linear_range;
+        // Continuity with vin^2 / 2 and vin^3 / 6 at the edge
+        integral_offset[side] = 0.5 * edge * edge - conductingIntegral(edge);
+        integral2_slope[side] = integral_offset[side];
+        integral2_offset[side] = edge * edge * edge / 6.0 -
+                                 conductingIntegral2(edge) -
+                                 integral2_slope[side] * edge;
+    }
 }
 
 inline float GermaniumDiode::processSample(float vin)
@@ -87,12 +119,202 @@ inline float GermaniumDiode::processSample(float vin)
         prev_v = vin;
         return vin;
     }
-    float q = k1 * vin - prev_p;
-    float r = (q > 0.0f) ? 1.0f : ((q < 0.0f) ? -1.0f : 0.0f); // sign function
-    float w = k2 * q + k3 * r;
-    float vout = w - v_t * r * omega(k4 * r * w + k5);
-    float p = k6 * vout - a1 * prev_p;
-    prev_p = p;
-    prev_v = vout;
+    prev_v = solve(vin, prev_p);
+    return prev_v;
+}
+
+inline float GermaniumDiode::shape(float vin) const
+{
+    float state = prev_p;
+    return solve(vin, state);
+}
+
+inline GermaniumDiode::Conducting
+GermaniumDiode::conducting(double vin) const
+{
+    double q = k1 * vin - prev_p;
+    double s = q > 0.0 ? 1.0 : -1.0;
+    double w = k2 * q + k3 * s;
+    double x = k4 * s * w + k5;
+    // One Newton step on o + log(o) = x from the approximation
+    double o = omega(static_cast<float>(x));
+    o -= (o + std::log(o) - x) / (1.0 + 1.0 / o);
+    return {s, w, o};
+}
+
+inline double GermaniumDiode::preciseShape(double vin) const
+{
+    if (std::abs(vin) < linear_range)
+        return vin;
+    Conducting c = conducting(vin);
+    return c.w - double(v_t) * c.s * c.o;
+}
+
+inline double GermaniumDiode::conductingIntegral(double vin) const
+{
+    Conducting c = conducting(vin);
+    return (c.w * c.w - double(v_t) * v_t * (c.o * c.o + 2.0 * c.o)) /
+           (2.0 * double(k1) * k2);
+}
+
+inline double GermaniumDiode::conductingIntegral2(double vin) const
+{
+    Conducting c = conducting(vin);
+    double v_t3 = double(v_t) * v_t * v_t;
+    double k1k2 = double(k1) * k2;
+    double o = c.o;
+    return (c.w * c.w * c.w / 3.0 -
+            c.s * v_t3 * (o * o * o / 3.0 + 1.5 * o * o + 2.0 * o)) /
+           (2.0 * k1k2 * k1k2);
+}
+
+inline double GermaniumDiode::shapeIntegral(double vin) const
+{
+    if (std::abs(vin) < linear_range)
+        return 0.5 * vin * vin;
+    return conductingIntegral(vin) + integral_offset[vin > 0.0 ? 0 : 1];
+}
+
+inline double GermaniumDiode::shapeIntegral2(double vin) const
+{
+    if (std::abs(vin) < linear_range)
+        return vin * vin * vin / 6.0;
+    int side = vin > 0.0 ? 0 : 1;
+    return conductingIntegral2(vin) + integral2_slope[side] * vin +
+           integral2_offset[side];
+}
+
+template <typename F> inline F GermaniumDiode::solve(F vin, F& state) const
+{
+    F q = k1 * vin - state;
+    F r = simd::select(
+        q > 0.0f, F(1.0f), simd::select(q < 0.0f, F(-1.0f), F(0.0f))
+    ); // sign function
+    F w = k2 * q + k3 * r;
+    F vout = w - v_t * r * omega(k4 * r * w + k5);
+    // Small signals go through untouched
+    vout = simd::select(simd::abs(vin) < linear_range, vin, vout);
+    state = k6 * vout - a1 * state;
     return vout;
 }
+
+// simd::width diodes, one per channel or instance, in lockstep on the
+// vectorised omega. Lanes past the channels in use run on silence.
+class GermaniumDiodeBatch
+{
+  public:
+    explicit GermaniumDiodeBatch(float fs = 44100.0f)
+        : model(fs), state(model.getState())
+    {
+    }
+
+    simd::vfloat processSample(simd::vfloat vin)
+    {
+        return model.solve(vin, state);
+    }
+
+    // One diode per channel, up to simd::width channels
+    void processBlock(float* const* channels, int numChannels, int numSamples)
+    {
+        numChannels = std::min(numChannels, simd::width);
+        alignas(32) float lanes[simd::width] = {};
+        for (int i = 0; i < numSamples; ++i)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                lanes[channel] = channels[channel][i];
+            simd::store(lanes, processSample(simd::load(lanes)));
+            for (int channel = 0; channel < numChannels; ++channel)
+                channels[channel][i] = lanes[channel];
+        }
+    }
+
+  private:
+    GermaniumDiode model;
+    simd::vfloat state;
+};
+
+// Antiderivative antialiased diode: the output is the mean of shape() over
+// the segment joining the last inputs, computed from the closed form
+// antiderivatives. Order 1 averages over one sample and delays by half a
+// sample, order 2 averages the first order result again and delays by one.
+// The aliases of the clipping drop by roughly 6 dB per octave and order,
+// see scripts/cpp/adaa_bench.cpp.
+//
+// The difference quotients lose precision as the inputs get close, below
+// a tolerance the mean is taken from the midpoint instead, whose error is
+// then of the same order as the rounding error it avoids.
+template <int Order> class AntialiasedGermaniumDiode
+{
+  public:
+    static_assert(Order == 1 || Order == 2, "first or second order");
+    static constexpr float latency = 0.5f * Order;
+
+    AntialiasedGermaniumDiode(float fs = 44100.0f) : model(fs)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        x1 = x2 = 0.0;
+        integral_1 = model.shapeIntegral(0.0);
+        integral2_1 = model.shapeIntegral2(0.0);
+        quotient_1 = 0.0;
+    }
+
+    float processSample(float vin)
+    {
+        double x = vin;
+        double y;
+        if constexpr (Order == 1)
+        {
+            double integral = model.shapeIntegral(x);
+            y = std::abs(x - x1) > tolerance
+                    ? (integral - integral_1) / (x - x1)
+                    : model.preciseShape(0.5 * (x + x1));
+            integral_1 = integral;
+        }
+        else
+        {
+            // Mean of shapeIntegral over [x1, x], then of that over the
+            // last two segments
+            double integral2 = model.shapeIntegral2(x);
+            double quotient =
+                std::abs(x - x1) > tolerance
+                    ? (integral2 - integral2_1) / (x - x1)
+                    : model.shapeIntegral(0.5 * (x + x1));
+            double span = x - x2;
+            if (std::abs(span) > tolerance)
+            {
+                y = 2.0 * (quotient - quotient_1) / span;
+            }
+            else
+            {
+                // x is back at x2, the segments fold onto [x1, x2]
+                double middle = 0.5 * (x + x2);
+                double delta = middle - x1;
+                y = std::abs(delta) > tolerance
+                        ? 2.0 / delta *
+                              (model.shapeIntegral(middle) +
+                               (integral2_1 - model.shapeIntegral2(middle)) /
+                                   delta)
+                        : model.preciseShape(0.5 * (middle + x1));
+            }
+            integral2_1 = integral2;
+            quotient_1 = quotient;
+            x2 = x1;
+        }
+        x1 = x;
+        return static_cast<float>(y);
+    }
+
+  private:
+    static constexpr double tolerance = 1e-5;
+
+    GermaniumDiode model;
+    double x1;
+    double x2;
+    double integral_1;
+    double integral2_1;
+    double quotient_1;
+};
@@ -1,13 +1,12 @@
 // triode.h
-// Single-file header-only implementation of the Triode class.
-// To use as a library, just #include this file.
-// To run the example, compile this file directly: g++ triode.h -o triode_sim
-// -std=c++17
+// Header-only wave digital filter model of a common cathode triode stage,
+// specialised at compile time on a tube model (see tubes.h).
 
 #pragma once
+#include "tubes.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
-#include <iostream>
-#include <vector>
 
 struct TriodeWaves
 {
@@ -16,173 +15,217 @@ struct TriodeWaves
     float bp;
 };
 
-class Triode
+// Every coefficient of the stage at one sample rate
+struct TriodeCoefficients
+{
+    float wpk_kt, wsp_kl;
+    float kTxCi, kTCk, kTCo, kT0;
+    float kyT, kyCo, ky0;
+    float kCiT, kCixCi;
+    float kCoCo, kCo0;
+    float bk_bp, k_delta, k_bp_s;
+    float bp_ap_0, bp_ak_0;
+    float k_delta_g, k_delta_k, k_delta_p, k_delta_0;
+    float k_d_root, k_vpk_root, k_grid_root;
+    float kp, kp2, kpg;
+
+    // DC operating point of the capacitor states
+    float wCk_0, wCo_0;
+
+    static constexpr TriodeCoefficients make(const TubeModel& tube, double fs);
+};
+
+template <typename Tube> class Triode
 {
   public:
-    // Constructor
-    Triode(float fs);
-    void initializeState();
+    static constexpr const TubeModel& model = Tube::model;
+
+    // Rates the coefficients are folded for at compile time, the usual base
+    // rates and twice and four times them: the overdrives design at the base
+    // rate or twice it. Any other rate computes them on construction.
+    static constexpr std::array<double, 8> precomputed_rates = {
+        44100.0,  48000.0,  88200.0,  96000.0,
+        176400.0, 192000.0, 352800.0, 384000.0
+    };
 
-    // Processes a block of samples (a vector)
-    // std::vector<float> process(const std::vector<float>& input);
+    explicit Triode(float fs);
+    // At the first precomputed rate
+    Triode();
 
     // Processes a single sample
     float processSample(float inputSample);
 
   private:
-    // padding to bring -12dB to ~0dB
-    float padding = -2.0f / 27.0f;
-    float kp = 1.014e-5;
-    float kp2 = 5.498e-8;
-    float kpg = 1.076e-5;
-    float E = 250;
-    float Ri = 1e6;
-    float Rg = 20e3;
-    float Ck = 10e-6;
-    float Co = 10e-9;
-    float Rp = 100e3;
-    float Ro = 1e6;
-    float Rk = 1e3;
-    float Ci = 100e-9;
+    // brings -12dB to ~0dB, the other tubes are levelled on the 12AX7
+    static constexpr float padding = static_cast<float>(
+        -2.0 / 27.0 * Tube12AX7::model.stageGain() / model.stageGain()
+    );
+
+    static constexpr std::array<TriodeCoefficients, 8> table = {
+        TriodeCoefficients::make(model, precomputed_rates[0]),
+        TriodeCoefficients::make(model, precomputed_rates[1]),
+        TriodeCoefficients::make(model, precomputed_rates[2]),
+        TriodeCoefficients::make(model, precomputed_rates[3]),
+        TriodeCoefficients::make(model, precomputed_rates[4]),
+        TriodeCoefficients::make(model, precomputed_rates[5]),
+        TriodeCoefficients::make(model, precomputed_rates[6]),
+        TriodeCoefficients::make(model, precomputed_rates[7]),
+    };
+
+    static TriodeCoefficients coefficientsFor(float fs);
+
+    TriodeCoefficients coef;
 
     // --- State Variables ---
     float wCi_s;
     float wCk_s;
     float wCo_s;
 
-    // --- Pre-calculated Coefficients ---
-    float wpg_kt, wpk_kt, wsp_kl, wpp_kt;
-    float kTxCi, kTCk, kTCo, kT0;
-    float kyT, kyCo, ky0;
-    float kCiT, kCixCi;
-    float kCoCo, kCo0;
-    float bk_bp, k_eta, k_delta, k_bp_s;
-    float bp_ap_0, bp_ak_0;
-
-    TriodeWaves triode(float ag, float ak, float ap);
+    TriodeWaves triode(float ag, float ak, float ap) const;
 };
 
-inline Triode::Triode(float fs)
+constexpr TriodeCoefficients
+TriodeCoefficients::make(const TubeModel& tube, double fs)
 {
-    float wVi_R = 1e-6;
-    float wCi_R = 1.0 / (2.0 * fs * Ci);
-    float wCk_R = 1.0 / (2.0 * fs * Ck);
-    float wCo_R = 1.0 / (2.0 * fs * Co);
-    float wsi_kl = wCi_R / (wCi_R + wVi_R);
-    float wsi_R = wCi_R + wVi_R;
-    wpg_kt = wsi_R / (wsi_R + Ri);
-    float wpg_R = (wsi_R * Ri) / (wsi_R + Ri);
-    float wsg_kl = Rg / (Rg + wpg_R);
-    wpk_kt = wCk_R / (Rk + wCk_R);
-    float wpk_R = (Rk * wCk_R) / (Rk + wCk_R);
-    wsp_kl = wCo_R / (wCo_R + Ro);
-    float wsp_R = wCo_R + Ro;
-    wpp_kt = wsp_R / (wsp_R + Rp);
-    float wpp_R = (wsp_R * Rp) / (wsp_R + Rp);
-
-    kTxCi = 1.0 - wpg_kt;
-    kTCk = 1.0 - wpk_kt;
-    kTCo = 1.0 - wpp_kt;
-    kT0 = wpp_kt * E;
-    kyT = 0.5 * (1.0 - wsp_kl);
-    kyCo = -0.5 * (1.0 - wsp_kl) * (1.0 + wpp_kt);
-    ky0 = 0.5 * (1.0 - wsp_kl) * wpp_kt * E;
-    kCiT = wsi_kl * (1.0 - wsg_kl);
-    kCixCi = wsi_kl * ((1.0 - wpg_kt) * (wsg_kl + 1.0) - 2.0);
-    kCoCo = 1.0 - wsp_kl * (1.0 + wpp_kt);
-    kCo0 = wsp_kl * wpp_kt * E;
+    TriodeCoefficients c = {};
+    double wVi_R = 1e-6;
+    double wCi_R = 1.0 / (2.0 * fs * tube.Ci);
+    double wCk_R = 1.0 / (2.0 * fs * tube.Ck);
+    double wCo_R = 1.0 / (2.0 * fs * tube.Co);
+    double wsi_kl = wCi_R / (wCi_R + wVi_R);
+    double wsi_R = wCi_R + wVi_R;
+    double wpg_kt = wsi_R / (wsi_R + tube.Ri);
+    double wpg_R = (wsi_R * tube.Ri) / (wsi_R + tube.Ri);
+    double wsg_kl = tube.Rg / (tube.Rg + wpg_R);
+    double wpk_kt = wCk_R / (tube.Rk + wCk_R);
+    double wpk_R = (tube.Rk * wCk_R) / (tube.Rk + wCk_R);
+    double wsp_kl = wCo_R / (wCo_R + tube.Ro);
+    double wsp_R = wCo_R + tube.Ro;
+    double wpp_kt = wsp_R / (wsp_R + tube.Rp);
+    double wpp_R = (wsp_R * tube.Rp) / (wsp_R + tube.Rp);
+    double E = tube.E;
+
+    c.wpk_kt = static_cast<float>(wpk_kt);
+    c.wsp_kl = static_cast<float>(wsp_kl);
+    c.kTxCi = static_cast<float>(1.0 - wpg_kt);
+    c.kTCk = static_cast<float>(1.0 - wpk_kt);
+    c.kTCo = static_cast<float>(1.0 - wpp_kt);
+    c.kT0 = static_cast<float>(wpp_kt * E);
+    c.kyT = static_cast<float>(0.5 * (1.0 - wsp_kl));
+    c.kyCo = static_cast<float>(-0.5 * (1.0 - wsp_kl) * (1.0 + wpp_kt));
+    c.ky0 = static_cast<float>(0.5 * (1.0 - wsp_kl) * wpp_kt * E);
+    c.kCiT = static_cast<float>(wsi_kl * (1.0 - wsg_kl));
+    c.kCixCi =
+        static_cast<float>(wsi_kl * ((1.0 - wpg_kt) * (wsg_kl + 1.0) - 2.0));
+    c.kCoCo = static_cast<float>(1.0 - wsp_kl * (1.0 + wpp_kt));
+    c.kCo0 = static_cast<float>(wsp_kl * wpp_kt * E);
 
     // Triode parameters
-    bk_bp = wpk_R / wpp_R;
-    k_eta = 1.0 / (bk_bp * (0.5 * kpg + kp2) + kp2);
-    k_delta = kp2 * k_eta * k_eta / (wpp_R + wpp_R);
-    k_bp_s = k_eta * std::sqrt((kp2 + kp2) / wpp_R);
-    bp_ap_0 = (1.0 / (wpp_R + wpk_R)) * (wpk_R - wpp_R);
-    bp_ak_0 = (1.0 / (wpp_R + wpk_R)) * (wpp_R + wpp_R);
-
-    float k1 = kpg / (2.0 * kp2) + Rp / Rk + 1.0;
-    float k2 = k1 * (kp / kp2 + 2.0 * E) * kp2;
-    float k3 = Rk * k2 + 1.0;
-    float sign_k1 = (k1 >= 0) ? 1.0 : -1.0;
-    float Vk0 =
-        (k3 - sign_k1 * std::sqrt(2.0 * k3 - 1.0)) / (2.0 * Rk * k1 * k1 * kp2);
-    float Vp0 = E - Rp / Rk * Vk0;
-
-    wCi_s = 0.0;
-    wCk_s = Vk0;
-    wCo_s = Vp0;
+    double kp = tube.kp;
+    double kp2 = tube.kp2;
+    double kpg = tube.kpg;
+    double bk_bp = wpk_R / wpp_R;
+    double k_eta = 1.0 / (bk_bp * (0.5 * kpg + kp2) + kp2);
+    double k_delta = kp2 * k_eta * k_eta / (wpp_R + wpp_R);
+    double k_bp_s = k_eta * constexprSqrt((kp2 + kp2) / wpp_R);
+    c.kp = static_cast<float>(kp);
+    c.kp2 = static_cast<float>(kp2);
+    c.kpg = static_cast<float>(kpg);
+    c.bk_bp = static_cast<float>(bk_bp);
+    c.k_delta = static_cast<float>(k_delta);
+    c.k_bp_s = static_cast<float>(k_bp_s);
+    c.bp_ap_0 = static_cast<float>((wpk_R - wpp_R) / (wpp_R + wpk_R));
+    c.bp_ak_0 = static_cast<float>((wpp_R + wpp_R) / (wpp_R + wpk_R));
+
+    // delta = ap + eta + k_delta expanded over the incident waves
+    c.k_delta_g = static_cast<float>(k_eta * kpg);
+    c.k_delta_k = static_cast<float>(-k_eta * (kpg + 2.0 * kp2));
+    c.k_delta_p =
+        static_cast<float>(1.0 + k_eta * (kp2 - bk_bp * (0.5 * kpg + kp2)));
+    c.k_delta_0 = static_cast<float>(k_eta * kp + k_delta);
+    // Slopes of d, Vpk2 and the grid condition against sqrt(delta)
+    double k_d_root = bk_bp * k_bp_s;
+    double k_vpk_root = k_bp_s * (1.0 + bk_bp);
+    c.k_d_root = static_cast<float>(k_d_root);
+    c.k_vpk_root = static_cast<float>(k_vpk_root);
+    c.k_grid_root = static_cast<float>(0.5 * kpg * k_d_root + kp2 * k_vpk_root);
+
+    c.wCk_0 = static_cast<float>(tube.cathodeBias());
+    c.wCo_0 = static_cast<float>(tube.plateBias());
+    return c;
 }
 
-// inline std::vector<float> Triode::process(const std::vector<float>& input)
-// {
-//     initializeState(); // Set initial DC operating point
-//     std::vector<float> output(input.size());
-//     for (size_t n = 0; n < input.size(); ++n)
-//     {
-//         output[n] = processSample(input[n]);
-//     }
-//     return output;
-// }
-
-inline float Triode::processSample(float inputSample)
+template <typename Tube>
+TriodeCoefficients Triode<Tube>::coefficientsFor(float fs)
 {
+    for (size_t i = 0; i < precomputed_rates.size(); ++i)
+    {
+        if (static_cast<float>(precomputed_rates[i]) == fs)
+            return table[i];
+    }
+    return TriodeCoefficients::make(model, fs);
+}
+
+template <typename Tube>
+Triode<Tube>::Triode(float fs)
+    : coef(coefficientsFor(fs)), wCi_s(0.0f), wCk_s(coef.wCk_0),
+      wCo_s(coef.wCo_0)
+{
+}
+
+template <typename Tube>
+Triode<Tube>::Triode() : Triode(static_cast<float>(precomputed_rates[0]))
+{
+}
+
+template <typename Tube>
+float Triode<Tube>::processSample(float inputSample)
+{
+    const TriodeCoefficients& c = coef;
     float xCi = inputSample + wCi_s;
-    float wT_ag = kTxCi * xCi;
-    float wT_ak = kTCk * wCk_s;
-    float wT_ap = kTCo * wCo_s + kT0;
+    float wT_ag = c.kTxCi * xCi;
+    float wT_ak = c.kTCk * wCk_s;
+    float wT_ap = c.kTCo * wCo_s + c.kT0;
 
     TriodeWaves waves = triode(wT_ag, wT_ak, wT_ap);
 
-    float vout = kyT * waves.bp + kyCo * wCo_s + ky0;
+    float vout = c.kyT * waves.bp + c.kyCo * wCo_s + c.ky0;
 
-    wCi_s = kCiT * waves.bg + kCixCi * xCi + wCi_s;
-    wCk_s = waves.bk - wpk_kt * wCk_s;
-    wCo_s = wsp_kl * waves.bp + kCoCo * wCo_s + kCo0;
+    wCi_s = c.kCiT * waves.bg + c.kCixCi * xCi + wCi_s;
+    wCk_s = waves.bk - c.wpk_kt * wCk_s;
+    wCo_s = c.wsp_kl * waves.bp + c.kCoCo * wCo_s + c.kCo0;
 
     return padding * vout;
 }
 
-inline TriodeWaves Triode::triode(float ag, float ak, float ap)
+template <typename Tube>
+TriodeWaves Triode<Tube>::triode(float ag, float ak, float ap) const
 {
-    float bp, bk;
-    float v1 = 0.5 * ap;
-    float v2 = ak + v1 * bk_bp;
-    float alpha = kpg * (ag - v2) + kp;
-    float beta = kp2 * (v1 - v2);
-    float eta = k_eta * (beta + beta + alpha);
-    float v3 = eta + k_delta;
-    float delta = ap + v3;
-    float Vpk;
-
-    if (delta >= 0)
-    {
-        bp = k_bp_s * std::sqrt(delta) - v3 - k_delta;
-        float d = bk_bp * (ap - bp);
-        bk = ak + d;
-        float Vpk2 = ap + bp - ak - bk;
-
-        if (kpg * (ag - ak - 0.5 * d) + kp2 * Vpk2 + kp < 0)
-        {
-            bp = ap;
-            bk = ak;
-            Vpk = ap - ak;
-        }
-        else
-        {
-            Vpk = 0.5 * Vpk2;
-        }
-    }
-    else
-    {
-        bp = ap;
-        bk = ak;
-        Vpk = ap - ak;
-    }
-
-    if (Vpk < 0)
-    {
-        bp = bp_ap_0 * ap + bp_ak_0 * ak;
-    }
+    // Everything but the square root is linear in the incident waves, so
+    // the terms are expanded ahead of time (see TriodeCoefficients::make):
+    // delta is a single dot product of the waves, and every quantity after
+    // the root is one multiply-add of it. Both the conducting and the
+    // cut-off solutions are then computed and selected without branching,
+    // which keeps the dependency chain through the filter state short.
+    const TriodeCoefficients& c = coef;
+    float delta =
+        c.k_delta_g * ag + c.k_delta_k * ak + c.k_delta_p * ap + c.k_delta_0;
+    float root = std::sqrt(std::max(delta, 0.0f));
+
+    float bp0 = ap - c.k_delta - delta;
+    float d0 = c.bk_bp * (ap - bp0);
+    float conducting_bp = c.k_bp_s * root + bp0;
+    float d = d0 - c.k_d_root * root;
+    float vpk0 = ap - ak - ak + bp0 - d0;
+    float Vpk2 = vpk0 + c.k_vpk_root * root;
+    float grid = (c.kpg * (ag - ak - 0.5f * d0) + c.kp2 * vpk0 + c.kp) +
+                 c.k_grid_root * root;
+
+    bool conducting = (delta >= 0.0f) & (grid >= 0.0f);
+    float bp = conducting ? conducting_bp : ap;
+    float bk = conducting ? ak + d : ak;
+    float Vpk = conducting ? 0.5f * Vpk2 : ap - ak;
+    bp = (Vpk < 0.0f) ? c.bp_ap_0 * ap + c.bp_ak_0 * ak : bp;
 
     float bg = ag;
     return {bg, bk, bp};
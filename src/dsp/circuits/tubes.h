@@ -0,0 +1,123 @@
+#pragma once
+
+// Tube and gain stage parameters for the Triode wave digital filter.
+//
+// The plate current follows a square law,
+//   Ip = kp2 * (Vpk + mu * Vgk + V0)^2, mu = kpg / (2 kp2), V0 = kp / (2 kp2)
+// The 12AX7 set is the one the overdrives were voiced with. The others are
+// fitted to their datasheet curves with their datasheet mu and scaled by
+// the same factors as the 12AX7 fit, so that the stages keep the same feel.
+// Each stage uses a common cathode circuit typical of the tube.
+
+struct TubeModel
+{
+    double kp;
+    double kp2;
+    double kpg;
+
+    double E;
+    double Ri;
+    double Rg;
+    double Ck;
+    double Co;
+    double Rp;
+    double Ro;
+    double Rk;
+    double Ci;
+
+    constexpr double mu() const
+    {
+        return kpg / (2.0 * kp2);
+    }
+
+    // DC cathode voltage, the grid sits at 0 V
+    constexpr double cathodeBias() const;
+    constexpr double plateBias() const
+    {
+        return E - Rp / Rk * cathodeBias();
+    }
+
+    // Small signal gain of the stage with the cathode bypassed
+    constexpr double stageGain() const;
+
+    // Time for the charge of the capacitors to decay by 60 dB once the
+    // input stops, from the longest of their time constants
+    constexpr double tailSeconds() const
+    {
+        double input = Ri * Ci;
+        double cathode = Rk * Ck;
+        double output = (Rp + Ro) * Co;
+        double longest = input > cathode ? input : cathode;
+        longest = longest > output ? longest : output;
+        return 6.91 * longest; // ln(1000) time constants
+    }
+};
+
+// std::sqrt is not constexpr before C++26
+constexpr double constexprSqrt(double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    double y = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 64; ++i)
+    {
+        double next = 0.5 * (y + x / y);
+        if (next == y)
+            break;
+        y = next;
+    }
+    return y;
+}
+
+constexpr double TubeModel::cathodeBias() const
+{
+    double k1 = kpg / (2.0 * kp2) + Rp / Rk + 1.0;
+    double k2 = k1 * (kp / kp2 + 2.0 * E) * kp2;
+    double k3 = Rk * k2 + 1.0;
+    double sign_k1 = (k1 >= 0) ? 1.0 : -1.0;
+    return (k3 - sign_k1 * constexprSqrt(2.0 * k3 - 1.0)) /
+           (2.0 * Rk * k1 * k1 * kp2);
+}
+
+constexpr double TubeModel::stageGain() const
+{
+    double vk = cathodeBias();
+    double vpk = plateBias() - vk;
+    double effective = vpk - mu() * vk + kp / (2.0 * kp2);
+    double ra = 1.0 / (2.0 * kp2 * effective);
+    double load = Rp * Ro / (Rp + Ro);
+    return mu() * load / (ra + load);
+}
+
+struct Tube12AX7
+{
+    static constexpr TubeModel model = {
+        1.014e-5, 5.498e-8, 1.076e-5, 250.0, 1e6,   20e3,
+        10e-6,    10e-9,    100e3,    1e6,   1e3,   100e-9,
+    };
+};
+
+struct Tube12AT7
+{
+    static constexpr TubeModel model = {
+        2.211e-5, 1.040e-7, 1.248e-5, 250.0, 1e6,   20e3,
+        10e-6,    10e-9,    47e3,     1e6,   820.0, 100e-9,
+    };
+};
+
+struct Tube12AU7
+{
+    static constexpr TubeModel model = {
+        3.115e-5, 1.512e-7, 5.140e-6, 250.0, 1e6,   20e3,
+        10e-6,    10e-9,    47e3,     1e6,   1.5e3, 100e-9,
+    };
+};
+
+// Triode strapped, as a driver ahead of a phase inverter
+struct TubeEL84Driver
+{
+    static constexpr TubeModel model = {
+        1.118e-4, 4.656e-7, 1.816e-5, 300.0, 1e6,   20e3,
+        47e-6,    47e-9,    10e3,     470e3, 270.0, 100e-9,
+    };
+};
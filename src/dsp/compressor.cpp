@@ -1,4 +1,6 @@
 #include "compressor.h"
+#include "filters/biquad_design.h"
+#include "maths/fast_math.h"
 
 #include <juce_dsp/juce_dsp.h>
 
@@ -18,210 +20,162 @@ void Compressor::applyLevel(juce::AudioBuffer<float>& buffer)
 void Compressor::prepare(const juce::dsp::ProcessSpec& spec)
 {
     processSpec = spec;
+    auto prepareModels = [&spec](auto&... model)
+    { ((model.prepare(spec.sampleRate), model.reset()), ...); };
+    std::apply(prepareModels, models);
+    std::apply(prepareModels, band_models);
+
+    bands.resize(static_cast<size_t>(std::max<juce::uint32>(
+        spec.maximumBlockSize, 1
+    )));
+    designed_low_crossover = 0.0f;
+    designed_high_crossover = 0.0f;
+    updateCrossovers(0);
+    bands_running = false;
 }
 
-void Compressor::computeGainReductionOptometric(float& sample, float sampleRate)
+void Compressor::updateCrossovers(int numSamples)
 {
-    // Optometric Compressor
-    //
-    // Envelope processing
-    float absSample = std::abs(sample);
-
-    float coef;
-    if (absSample > envelopeLevel)
-    {
-        coef = std::exp(-1.0f / (sampleRate * optoParams.attack));
-    }
-    else
+    if (designed_low_crossover == low_crossover &&
+        designed_high_crossover == high_crossover)
     {
-        if (envelopeLevel > threshold)
-        {
-            coef = std::exp(-1.0f / (sampleRate * optoParams.release1));
-        }
-        else
-        {
-            coef = std::exp(-1.0f / (sampleRate * optoParams.release2));
-        }
+        return;
     }
-    envelopeLevel = (coef * envelopeLevel) + ((1.0f - coef) * absSample);
+    designed_low_crossover = low_crossover;
+    designed_high_crossover = high_crossover;
+    double sample_rate = processSpec.sampleRate;
 
-    // Gain Comutation
-    float rawGainReduction;
-    float rawGainReductionDb;
-    if (envelopeLevel > threshold)
+    BiquadCoefficients low_pass = rbj::lowPass(sample_rate, low_crossover);
+    BiquadCoefficients high_pass = rbj::highPass(sample_rate, low_crossover);
+    for (int layer = 0; layer < 2; ++layer)
     {
-        float overThreshold = juce::Decibels::gainToDecibels(envelopeLevel) -
-                              juce::Decibels::gainToDecibels(threshold);
-        rawGainReductionDb = -overThreshold * (1.0f - 1.0f / ratio);
+        crossover[layer].setTarget(0, low_pass);
+        crossover[layer].setTarget(1, high_pass);
+        crossover[layer].setTarget(2, high_pass);
     }
-    else
+
+    low_pass = rbj::lowPass(sample_rate, high_crossover);
+    high_pass = rbj::highPass(sample_rate, high_crossover);
+    crossover[2].setTarget(0, rbj::allPass(sample_rate, high_crossover));
+    for (int layer = 2; layer < 4; ++layer)
     {
-        rawGainReductionDb = 0.0f; // No compression when below threshold
+        crossover[layer].setTarget(1, low_pass);
+        crossover[layer].setTarget(2, high_pass);
     }
 
-    rawGainReduction = juce::Decibels::decibelsToGain(rawGainReductionDb);
-
-    float gainSmoothingCoef =
-        std::exp(-1.0f / (sampleRate * optoParams.gainSmoothingTime));
-
-    gainReduction = (gainSmoothingCoef * gainReduction) +
-                    ((1.0f - gainSmoothingCoef) * rawGainReduction);
-    gainReductionDb = juce::Decibels::gainToDecibels(gainReduction);
-    sample = (sample * gainReduction * mix) + (sample * (1.0f - mix));
-
-    // Saturation
-    float saturated = std::tanh(sample * (1.0f + optoParams.saturationAmount));
-    sample = sample + (saturated - sample) * optoParams.saturationAmount *
-                          optoParams.saturationMix;
+    for (auto& layer : crossover)
+        layer.glide(numSamples);
 }
 
-void Compressor::computeGainReductionFet(float& sample, float sampleRate)
+void Compressor::processBands(
+    float* samples, int numSamples, const CompressorSettings& settings
+)
 {
-    // FET-style peak envelope processing (much faster)
-    float absSample = std::abs(sample);
-    float coef;
-
-    if (absSample > envelopeLevel)
+    if (!bands_running)
     {
-        coef = std::exp(-1.0f / (sampleRate * fetParams.attack));
+        for (auto& layer : crossover)
+            layer.reset();
+        band_state = {};
+        bands_running = true;
     }
-    else
-    {
-        coef = std::exp(-1.0f / (sampleRate * fetParams.release));
-    }
-    envelopeLevel = (coef * envelopeLevel) + ((1.0f - coef) * absSample);
-
-    // FET Gain Reduction (more aggressive, higher ratios)
-    float rawGainReduction;
-    float rawGainReductionDb;
-    if (envelopeLevel > threshold)
-    {
-        float overThreshold = juce::Decibels::gainToDecibels(envelopeLevel) -
-                              juce::Decibels::gainToDecibels(threshold);
-        rawGainReductionDb = -overThreshold * (1.0f - 1.0f / ratio);
+    updateCrossovers(numSamples);
 
-        rawGainReductionDb = std::max(rawGainReductionDb, -40.0f);
-    }
-    else
+    const int chunk = static_cast<int>(bands.size());
+    for (int start = 0; start < numSamples; start += chunk)
     {
-        rawGainReductionDb = 0.0f;
-    }
-    rawGainReduction = juce::Decibels::decibelsToGain(rawGainReductionDb);
-
-    float gainSmoothingCoef =
-        std::exp(-1.0f / (sampleRate * fetParams.gainSmoothingTime));
-    gainReduction = (gainSmoothingCoef * gainReduction) +
-                    ((1.0f - gainSmoothingCoef) * rawGainReduction);
-    gainReductionDb = juce::Decibels::gainToDecibels(gainReduction);
+        float* x = samples + start;
+        int length = std::min(chunk, numSamples - start);
+        for (int i = 0; i < length; ++i)
+        {
+            simd::vfloat4 y = simd::set4(x[i], x[i], x[i], 0.0f);
+            for (auto& layer : crossover)
+                y = layer.processSample(y);
+            bands[static_cast<size_t>(i)] = y;
+        }
 
-    // Apply compression
-    sample = (sample * gainReduction * mix) + (sample * (1.0f - mix));
+        dispatch(
+            band_models, type,
+            [&](auto& model)
+            { model.process(bands.data(), length, settings, band_state); }
+        );
 
-    // FET-style saturation (more aggressive, asymmetric)
-    float driven = sample * (1.0f + fetParams.saturationAmount * 2.0f);
-    float fetSaturated;
-    if (driven > 0.0f)
-    {
-        fetSaturated = std::tanh(driven * 1.5f); // Harder positive saturation
-    }
-    else
-    {
-        fetSaturated = std::tanh(driven * 0.8f); // Softer negative (asymmetric)
+        float lanes[4];
+        for (int i = 0; i < length; ++i)
+        {
+            simd::store4(lanes, bands[static_cast<size_t>(i)]);
+            x[i] = lanes[0] + lanes[1] + lanes[2];
+        }
     }
 
-    // More aggressive saturation blend for FET punch
-    sample = sample + (fetSaturated - sample) * fetParams.saturationAmount *
-                          fetParams.saturationMix;
+    // The meter shows the band compressed the most
+    float gains[4];
+    simd::store4(gains, band_state.gain);
+    gainReductionDb =
+        fast_math::gainToDecibels(std::min({gains[0], gains[1], gains[2]}));
 }
 
-void Compressor::computeGainReductionVca(float& sample, float sampleRate)
+void Compressor::applySaturation(float* samples, int numSamples) const
 {
-    float absSample = std::abs(sample);
-
-    static float rmsBuffer[64] = {0}; // Small buffer for RMS calculation
-    static int rmsIndex = 0;
-
-    rmsBuffer[rmsIndex] = absSample * absSample;
-    rmsIndex = (rmsIndex + 1) % 64;
-
-    float rmsSum = 0.0f;
-    for (int i = 0; i < 64; ++i)
-        rmsSum += rmsBuffer[i];
-
-    float rmsLevel = std::sqrt(rmsSum / 64.0f);
-
-    float coef;
-    if (rmsLevel > envelopeLevel)
-    {
-        coef = std::exp(-1.0f / (sampleRate * vcaParams.attack));
-    }
-    else
+    if (!saturation_pending)
     {
-        coef = std::exp(-1.0f / (sampleRate * vcaParams.release));
+        return;
     }
-    envelopeLevel = (coef * envelopeLevel) + ((1.0f - coef) * rmsLevel);
-
-    float rawGainReduction;
-    float rawGainReductionDb;
-    if (envelopeLevel > threshold)
-    {
-        float overThreshold = juce::Decibels::gainToDecibels(envelopeLevel) -
-                              juce::Decibels::gainToDecibels(threshold);
-
-        rawGainReductionDb = -overThreshold * (1.0f - 1.0f / ratio);
-
-        if (overThreshold < vcaParams.kneeWidth)
+    // The level follows the saturation, ramped over the block as in
+    // applyLevel whatever the rate the block runs at.
+    withModel(
+        [&](const auto& model)
         {
-            float kneeRatio = overThreshold / vcaParams.kneeWidth;
-            rawGainReductionDb *= (kneeRatio * kneeRatio);
+            model.saturate(
+                samples, numSamples, level_ramp_start, level_ramp_end
+            );
         }
-    }
-    else
-    {
-        rawGainReductionDb = 0.0f;
-    }
-
-    rawGainReduction = juce::Decibels::decibelsToGain(rawGainReductionDb);
-
-    float gainSmoothingCoef =
-        std::exp(-1.0f / (sampleRate * vcaParams.gainSmoothingTime));
-    gainReduction = (gainSmoothingCoef * gainReduction) +
-                    ((1.0f - gainSmoothingCoef) * rawGainReduction);
-    gainReductionDb = juce::Decibels::gainToDecibels(gainReduction);
-
-    sample = (sample * gainReduction * mix) + (sample * (1.0f - mix));
-
-    float cleanSaturated =
-        sample / (1.0f + std::abs(sample * vcaParams.saturationAmount * 0.5f));
-    sample = sample + (cleanSaturated - sample) * vcaParams.saturationAmount *
-                          vcaParams.saturationMix;
+    );
 }
 
 void Compressor::process(juce::AudioBuffer<float>& buffer)
 {
+    saturation_pending = false;
     if (bypass)
     {
         gainReductionDb = 0.0f;
         return;
     }
-    float sampleRate = static_cast<float>(processSpec.sampleRate);
+    CompressorSettings settings;
+    settings.threshold = threshold;
+    settings.threshold_db = fast_math::gainToDecibels(threshold);
+    settings.ratio = ratio;
+    settings.mix = mix;
 
     auto* channelData = buffer.getWritePointer(0);
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+    const int numSamples = buffer.getNumSamples();
+    if (multiband)
     {
-        switch (type)
+        processBands(channelData, numSamples, settings);
+    }
+    else
+    {
+        bands_running = false;
+        withModel([&](auto& model)
+                  { model.process(channelData, numSamples, settings, state); }
+        );
+        gainReductionDb = fast_math::gainToDecibels(state.gain);
+    }
+
+    level_ramp_start = previous_level;
+    level_ramp_end = level;
+    previous_level = level;
+    if (saturation_deferred)
+    {
+        // Saturation and level are left to applySaturation
+        saturation_pending = true;
+        return;
+    }
+    withModel(
+        [&](const auto& model)
         {
-        case 0:
-            computeGainReductionOptometric(channelData[sample], sampleRate);
-            break;
-        case 1:
-            computeGainReductionFet(channelData[sample], sampleRate);
-            break;
-        case 2:
-            computeGainReductionVca(channelData[sample], sampleRate);
-            break;
+            model.saturate(
+                channelData, numSamples, level_ramp_start, level_ramp_end
+            );
         }
-    }
-    // apply level
-    applyLevel(buffer);
+    );
 }
@@ -1,8 +1,22 @@
 #pragma once
 
+#include "compressor_kernel.h"
+#include "filters/parallel_biquad.h"
+
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
+#include <tuple>
+#include <utility>
+#include <vector>
 
+// The models are CompressorKernel instances, see compressor_kernel.h. The
+// type is dispatched once per block.
+//
+// In multiband mode the signal is split in three bands by fourth order
+// Linkwitz-Riley crossovers, which sum back to an all-pass. The bands run
+// side by side in the lanes of a simd::vfloat4 through the same model,
+// each compressed by its own level, and the saturation follows on their
+// sum.
 class Compressor
 {
   public:
@@ -10,9 +24,19 @@ class Compressor
     void applyLevel(juce::AudioBuffer<float>& buffer);
     void prepare(const juce::dsp::ProcessSpec& spec);
     void process(juce::AudioBuffer<float>& buffer);
-    void computeGainReductionOptometric(float& sample, float sampleRate);
-    void computeGainReductionFet(float& sample, float sampleRate);
-    void computeGainReductionVca(float& sample, float sampleRate);
+
+    // When deferred, process() only applies the gain reduction and the
+    // caller runs applySaturation() on the block, possibly oversampled.
+    void setSaturationDeferred(bool shouldDefer)
+    {
+        saturation_deferred = shouldDefer;
+    }
+    bool hasPendingSaturation() const
+    {
+        return saturation_pending;
+    }
+    // Saturation and output level of the last processed block
+    void applySaturation(float* samples, int numSamples) const;
 
     void setRatio(float newRatio)
     {
@@ -42,12 +66,72 @@ class Compressor
         type = index;
     }
 
+    void setMultiband(bool shouldBeMultiband)
+    {
+        multiband = shouldBeMultiband;
+    }
+    // Redesigned at the next block, the crossovers glide across it
+    void setCrossoverFrequencies(float lowFrequency, float highFrequency)
+    {
+        low_crossover = lowFrequency;
+        high_crossover = highFrequency;
+    }
+
+    // Runs the gain computer four times less often
+    void setCoarseControl(bool coarse)
+    {
+        auto setCoarse = [coarse](auto&... model)
+        { (model.setCoarseControl(coarse), ...); };
+        std::apply(setCoarse, models);
+        std::apply(setCoarse, band_models);
+    }
+
     float getGainReductionDb()
     {
         return gainReductionDb;
     }
+    // The output stops with the input, this is how long the state takes
+    // to come back to rest
+    double getSettleSeconds() const
+    {
+        float seconds = 0.0f;
+        withModel([&seconds](const auto& model)
+                  { seconds = model.settleTime(); });
+        return seconds;
+    }
 
   private:
+    void processBands(
+        float* samples, int numSamples, const CompressorSettings& settings
+    );
+    void updateCrossovers(int numSamples);
+
+    // Calls function with the model of the current type
+    template <typename Function> void withModel(Function&& function)
+    {
+        dispatch(models, type, function);
+    }
+    template <typename Function> void withModel(Function&& function) const
+    {
+        dispatch(models, type, function);
+    }
+    template <typename Models, typename Function>
+    static void dispatch(Models& models, int type, Function&& function)
+    {
+        dispatch(
+            models, type, function, std::make_index_sequence<num_models>{}
+        );
+    }
+    template <typename Models, typename Function, std::size_t... I>
+    static void dispatch(
+        Models& models, int type, Function& function, std::index_sequence<I...>
+    )
+    {
+        (void)((type == static_cast<int>(I) &&
+                (function(std::get<I>(models)), true)) ||
+               ...);
+    }
+
     juce::dsp::ProcessSpec processSpec{-1, 0, 0};
     int debugCounter = 0;
 
@@ -59,39 +143,58 @@ class Compressor
     float level;
     float ratio;
 
-    // internal state of compressor
-    float envelopeLevel = 1.0f;
+    CompressorState<> state;
     float previous_level = 1.0f;
     float gainReductionDb = 0.0f;
-    float gainReduction = 1.0f;
-
-    // hardcoded parameters for optometric compressor
-    struct
-    {
-        float attack = 0.01f;
-        float release1 = 0.06f;
-        float release2 = 0.5f;
-        float saturationAmount = 0.2f;
-        float saturationMix = 0.05f;
-        float gainSmoothingTime = 0.05f;
-    } optoParams;
-
-    struct
-    {
-        float attack = 0.0003f;
-        float release = 0.1f;
-        float saturationAmount = 0.4f;
-        float saturationMix = 0.15f;
-        float gainSmoothingTime = 0.01f;
-    } fetParams;
-
-    struct
-    {
-        float attack = 0.005f;
-        float release = 0.4f;
-        float saturationAmount = 0.2f;
-        float saturationMix = 0.05f;
-        float gainSmoothingTime = 0.01f;
-        float kneeWidth = 2.0f;
-    } vcaParams;
+
+    bool saturation_deferred = false;
+    bool saturation_pending = false;
+    float level_ramp_start = 1.0f;
+    float level_ramp_end = 1.0f;
+
+    bool multiband = false;
+    bool bands_running = false;
+    float low_crossover = 200.0f;
+    float high_crossover = 2500.0f;
+    float designed_low_crossover = 0.0f;
+    float designed_high_crossover = 0.0f;
+
+    // The three bands, one per lane, each layer holding the next filter of
+    // every band:
+    //   lane      0 low          1 mid           2 high
+    //   layer 0   low-pass low   high-pass low   high-pass low
+    //   layer 1   low-pass low   high-pass low   high-pass low
+    //   layer 2   all-pass high  low-pass high   high-pass high
+    //   layer 3   -              low-pass high   high-pass high
+    // The all-pass gives the low band the phase the split at the high
+    // crossover gives the other two, so that the three sum flat.
+    ParallelBiquad crossover[4];
+    std::vector<simd::vfloat4> bands;
+    CompressorState<simd::vfloat4> band_state;
+
+    // hardcoded parameters of the models, in the order of the type index,
+    // see makeModels()
+    template <typename F>
+    using Optometric = CompressorKernel<
+        ProgramDependentDetector<F>, HardKnee, TanhSaturator>;
+    template <typename F>
+    using Fet =
+        CompressorKernel<PeakDetector<F>, LimitedHardKnee, AsymmetricSaturator>;
+    template <typename F>
+    using Vca = CompressorKernel<RmsDetector<F>, SoftKnee, SoftClipSaturator>;
+    template <typename F>
+    using Models = std::tuple<Optometric<F>, Fet<F>, Vca<F>>;
+
+    template <typename F> static Models<F> makeModels()
+    {
+        return {
+            Optometric<F>{{0.01f, 0.06f, 0.5f}, {}, {0.2f, 0.05f}, 0.05f},
+            Fet<F>{{0.0003f, 0.1f}, {-40.0f}, {0.4f, 0.15f}, 0.01f},
+            Vca<F>{{0.005f, 0.4f}, {2.0f}, {0.2f, 0.05f}, 0.01f}
+        };
+    }
+
+    static constexpr std::size_t num_models = 3;
+    Models<float> models = makeModels<float>();
+    Models<simd::vfloat4> band_models = makeModels<simd::vfloat4>();
 };
@@ -0,0 +1,439 @@
+#pragma once
+
+#include "maths/fast_math.h"
+#include "maths/simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+// The compressor models as combinations of four policies, each model a
+// CompressorKernel instantiated for its own detector, gain computer and
+// saturator, so that its block loops are compiled for it alone:
+//
+//   detector       F processSample(F envelope, F absSample, F threshold)
+//                  advances the envelope by one sample, plus prepare(fs),
+//                  reset() and releaseTime(). F is the Sample type of the
+//                  detector: float, or simd::vfloat4 for four signals side
+//                  by side
+//   gain computer  float gainReductionDb(float overThresholdDb, float ratio)
+//   smoother       the one pole gain smoother of the kernel, run at control
+//                  rate
+//   saturator      float processSample(float) const
+//
+// A new model is a new combination, possibly with a new policy, and costs
+// the existing ones nothing. The gain computer and the saturator always
+// work on floats, the first at control rate lane by lane.
+
+inline float onePoleCoefficient(double sampleRate, float time)
+{
+    // exp(-1 / (fs * time))
+    return std::exp(-1.0f / (static_cast<float>(sampleRate) * time));
+}
+
+// Attack when the level rises above the envelope, release otherwise
+template <typename F = float> class PeakDetector
+{
+  public:
+    using Sample = F;
+
+    PeakDetector(float attackTime, float releaseTime)
+        : attack_time(attackTime), release_time(releaseTime)
+    {
+    }
+
+    void prepare(double sampleRate)
+    {
+        attack = onePoleCoefficient(sampleRate, attack_time);
+        release = onePoleCoefficient(sampleRate, release_time);
+    }
+    void reset()
+    {
+    }
+
+    float releaseTime() const
+    {
+        return release_time;
+    }
+
+    F processSample(F envelope, F absSample, F) const
+    {
+        F coef = simd::select(absSample > envelope, F(attack), F(release));
+        return (coef * envelope) + ((F(1.0f) - coef) * absSample);
+    }
+
+  private:
+    float attack_time;
+    float release_time;
+    float attack = 0.0f;
+    float release = 0.0f;
+};
+
+// Releases fast while above the threshold and slowly below it, as the
+// cell of an optical compressor does
+template <typename F = float> class ProgramDependentDetector
+{
+  public:
+    using Sample = F;
+
+    ProgramDependentDetector(
+        float attackTime, float fastReleaseTime, float slowReleaseTime
+    )
+        : attack_time(attackTime), fast_release_time(fastReleaseTime),
+          slow_release_time(slowReleaseTime)
+    {
+    }
+
+    void prepare(double sampleRate)
+    {
+        attack = onePoleCoefficient(sampleRate, attack_time);
+        fast_release = onePoleCoefficient(sampleRate, fast_release_time);
+        slow_release = onePoleCoefficient(sampleRate, slow_release_time);
+    }
+    void reset()
+    {
+    }
+
+    float releaseTime() const
+    {
+        return slow_release_time;
+    }
+
+    F processSample(F envelope, F absSample, F threshold) const
+    {
+        F release = simd::select(
+            envelope > threshold, F(fast_release), F(slow_release)
+        );
+        F coef = simd::select(absSample > envelope, F(attack), release);
+        return (coef * envelope) + ((F(1.0f) - coef) * absSample);
+    }
+
+  private:
+    float attack_time;
+    float fast_release_time;
+    float slow_release_time;
+    float attack = 0.0f;
+    float fast_release = 0.0f;
+    float slow_release = 0.0f;
+};
+
+// Peak detection of the RMS level over the last window_size samples
+template <typename F = float> class RmsDetector
+{
+  public:
+    using Sample = F;
+    static constexpr int window_size = 64;
+
+    RmsDetector(float attackTime, float releaseTime)
+        : follower(attackTime, releaseTime)
+    {
+    }
+
+    void prepare(double sampleRate)
+    {
+        follower.prepare(sampleRate);
+    }
+    void reset()
+    {
+        std::fill(window, window + window_size, F(0.0f));
+        sum = F(0.0f);
+        index = 0;
+    }
+
+    float releaseTime() const
+    {
+        return follower.releaseTime();
+    }
+
+    F processSample(F envelope, F absSample, F threshold)
+    {
+        F square = absSample * absSample;
+        sum = sum + (square - window[index]);
+        window[index] = square;
+        if (++index == window_size)
+        {
+            // Summed again once per window, the running sum does not drift
+            index = 0;
+            sum = F(0.0f);
+            for (F s : window)
+                sum = sum + s;
+        }
+        F rms = simd::sqrt(
+            simd::max(sum, F(0.0f)) * F(1.0f / static_cast<float>(window_size))
+        );
+        return follower.processSample(envelope, rms, threshold);
+    }
+
+  private:
+    PeakDetector<F> follower;
+    F window[window_size] = {};
+    F sum = F(0.0f);
+    int index = 0;
+};
+
+struct HardKnee
+{
+    float gainReductionDb(float overThresholdDb, float ratio) const
+    {
+        return -overThresholdDb * (1.0f - 1.0f / ratio);
+    }
+};
+
+// Hard knee with a maximum gain reduction
+struct LimitedHardKnee
+{
+    float floor_db;
+
+    float gainReductionDb(float overThresholdDb, float ratio) const
+    {
+        return std::max(-overThresholdDb * (1.0f - 1.0f / ratio), floor_db);
+    }
+};
+
+// The ratio eases in quadratically over the first width_db above the
+// threshold
+struct SoftKnee
+{
+    float width_db;
+
+    float gainReductionDb(float overThresholdDb, float ratio) const
+    {
+        float reduction_db = -overThresholdDb * (1.0f - 1.0f / ratio);
+        if (overThresholdDb < width_db)
+        {
+            float knee = overThresholdDb / width_db;
+            reduction_db *= knee * knee;
+        }
+        return reduction_db;
+    }
+};
+
+struct TanhSaturator
+{
+    float amount;
+    float mix;
+
+    float processSample(float sample) const
+    {
+        float saturated = fast_math::tanh(sample * (1.0f + amount));
+        return sample + (saturated - sample) * amount * mix;
+    }
+};
+
+// Harder on the positive side, as a FET stage
+struct AsymmetricSaturator
+{
+    float amount;
+    float mix;
+
+    float processSample(float sample) const
+    {
+        float driven = sample * (1.0f + amount * 2.0f);
+        float hardness = driven > 0.0f ? 1.5f : 0.8f;
+        float saturated = fast_math::tanh(driven * hardness);
+        return sample + (saturated - sample) * amount * mix;
+    }
+};
+
+struct SoftClipSaturator
+{
+    float amount;
+    float mix;
+
+    float processSample(float sample) const
+    {
+        float clipped = sample / (1.0f + std::abs(sample * amount * 0.5f));
+        return sample + (clipped - sample) * amount * mix;
+    }
+};
+
+// Envelope and smoothed gain, shared by the models so that switching
+// between them does not jump
+template <typename F = float> struct CompressorState
+{
+    F envelope = F(1.0f);
+    F gain = F(1.0f);
+};
+
+struct CompressorSettings
+{
+    float threshold = 1.0f;
+    float threshold_db = 0.0f;
+    float ratio = 1.0f;
+    float mix = 1.0f;
+};
+
+// The detector runs at audio rate, the gain computer and the smoother at
+// control rate: once per control_interval samples, from the mean of the
+// envelope over the interval, with the gain ramped linearly across it.
+// Against the same computation run every sample the gain stays within
+// 0.1 dB through attacks and releases. The coarse interval, for when the
+// time runs short, trades some of that accuracy away.
+template <typename Detector, typename GainComputer, typename Saturator>
+class CompressorKernel
+{
+  public:
+    using F = typename Detector::Sample;
+    static constexpr int control_interval = 16;
+    static constexpr int coarse_control_interval = 64;
+
+    CompressorKernel(
+        Detector detector, GainComputer gainComputer, Saturator saturator,
+        float gainSmoothingTime
+    )
+        : detector(detector), gain_computer(gainComputer),
+          saturator(saturator), gain_smoothing_time(gainSmoothingTime)
+    {
+    }
+
+    void prepare(double sampleRate)
+    {
+        detector.prepare(sampleRate);
+        smoothing = onePoleCoefficient(sampleRate, gain_smoothing_time);
+        control_smoothing = onePoleCoefficient(
+            sampleRate, gain_smoothing_time / control_interval
+        );
+        coarse_control_smoothing = onePoleCoefficient(
+            sampleRate, gain_smoothing_time / coarse_control_interval
+        );
+        setCoarseControl(interval == coarse_control_interval);
+    }
+
+    // The gain keeps ramping from where it is, the change is seamless
+    void setCoarseControl(bool coarse)
+    {
+        interval = coarse ? coarse_control_interval : control_interval;
+        interval_smoothing = coarse ? coarse_control_smoothing
+                                    : control_smoothing;
+    }
+
+    void reset()
+    {
+        detector.reset();
+    }
+
+    // Time for the envelope and the gain to come back to rest, 60 dB of
+    // the slower of the release and the gain smoothing
+    float settleTime() const
+    {
+        return 6.91f * std::max(detector.releaseTime(), gain_smoothing_time);
+    }
+
+    // Applies the gain reduction, mixed with the dry signal
+    void process(
+        F* samples, int numSamples, const CompressorSettings& settings,
+        CompressorState<F>& state
+    )
+    {
+        for (int start = 0; start < numSamples; start += interval)
+        {
+            int length = std::min(interval, numSamples - start);
+            F envelope = detect(samples + start, length, settings, state);
+            F target = computeGain(envelope, settings);
+            applyGain(samples + start, length, target, settings.mix, state);
+        }
+    }
+
+    // Saturates, then applies a level ramped across the block
+    void saturate(
+        float* samples, int numSamples, float levelStart, float levelEnd
+    ) const
+    {
+        float step = (levelEnd - levelStart) /
+                     static_cast<float>(std::max(numSamples, 1));
+        float level = levelStart;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            samples[i] = level * saturator.processSample(samples[i]);
+            level += step;
+        }
+    }
+
+  private:
+    // Mean of the envelope over the samples
+    F detect(
+        const F* samples, int numSamples, const CompressorSettings& settings,
+        CompressorState<F>& state
+    )
+    {
+        const F threshold(settings.threshold);
+        F envelope = state.envelope;
+        F sum(0.0f);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            envelope = detector.processSample(
+                envelope, simd::abs(samples[i]), threshold
+            );
+            sum = sum + envelope;
+        }
+        state.envelope = envelope;
+        return sum * F(1.0f / static_cast<float>(numSamples));
+    }
+
+    F computeGain(F envelope, const CompressorSettings& settings) const
+    {
+        if constexpr (std::is_same_v<F, float>)
+        {
+            return fast_math::decibelsToGain(
+                computeGainReductionDb(envelope, settings)
+            );
+        }
+        else
+        {
+            float lanes[4];
+            simd::store4(lanes, envelope);
+            for (float& lane : lanes)
+                lane = fast_math::decibelsToGain(
+                    computeGainReductionDb(lane, settings)
+                );
+            return simd::load4(lanes);
+        }
+    }
+
+    float computeGainReductionDb(
+        float envelope, const CompressorSettings& settings
+    ) const
+    {
+        if (envelope <= settings.threshold)
+            return 0.0f; // No compression when below threshold
+        float over_threshold_db =
+            fast_math::gainToDecibels(envelope) - settings.threshold_db;
+        return gain_computer.gainReductionDb(over_threshold_db, settings.ratio);
+    }
+
+    void applyGain(
+        F* samples, int numSamples, F target, float mix,
+        CompressorState<F>& state
+    ) const
+    {
+        // The smoother runs once for the interval, as it would sample by
+        // sample towards a constant target, and the gain ramps to where it
+        // ends. Only the last interval of a block can be shorter.
+        float coef = numSamples == interval
+                         ? interval_smoothing
+                         : std::pow(smoothing, static_cast<float>(numSamples));
+        F gain = state.gain;
+        state.gain = (F(coef) * state.gain) + (F(1.0f - coef) * target);
+
+        F step = (state.gain - gain) * F(1.0f / static_cast<float>(numSamples));
+        // The dry and wet signals only differ by the gain, the mix is one
+        // gain on the samples in place
+        const F wet(mix);
+        const F dry(1.0f - mix);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            gain = gain + step;
+            samples[i] = samples[i] * (dry + gain * wet);
+        }
+    }
+
+    Detector detector;
+    GainComputer gain_computer;
+    Saturator saturator;
+    float gain_smoothing_time;
+    float smoothing = 0.0f;
+    float control_smoothing = 0.0f;
+    float coarse_control_smoothing = 0.0f;
+    int interval = control_interval;
+    float interval_smoothing = 0.0f;
+};
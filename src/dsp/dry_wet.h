@@ -0,0 +1,43 @@
+#pragma once
+
+#include "maths/simd.h"
+
+#include <algorithm>
+
+// dst = dry * (1 - m) + wet * m * g, with the mix m and the wet gain g
+// ramped linearly from their start to their end values across the block,
+// as juce::AudioBuffer::applyGainRamp does. dst may be either input, and a
+// block that is fully wet at both ends can pass its wet samples as dry.
+inline void mixDryWet(
+    float* dst, const float* dry, const float* wet, int numSamples,
+    float mixStart, float mixEnd, float gainStart, float gainEnd
+)
+{
+    using simd::vfloat;
+    float scale = 1.0f / static_cast<float>(std::max(numSamples, 1));
+    float mix_step = (mixEnd - mixStart) * scale;
+    float gain_step = (gainEnd - gainStart) * scale;
+
+    alignas(32) float offsets[simd::width];
+    for (int lane = 0; lane < simd::width; ++lane)
+        offsets[lane] = static_cast<float>(lane);
+    const vfloat lanes = simd::load(offsets);
+
+    int i = 0;
+    for (; i + simd::width <= numSamples; i += simd::width)
+    {
+        vfloat index = vfloat(static_cast<float>(i)) + lanes;
+        vfloat m = vfloat(mixStart) + index * vfloat(mix_step);
+        vfloat g = vfloat(gainStart) + index * vfloat(gain_step);
+        vfloat d = simd::load(dry + i);
+        vfloat w = simd::load(wet + i);
+        simd::store(dst + i, d + m * (w * g - d));
+    }
+    for (; i < numSamples; ++i)
+    {
+        float index = static_cast<float>(i);
+        float m = mixStart + index * mix_step;
+        float g = gainStart + index * gain_step;
+        dst[i] = dry[i] + m * (wet[i] * g - dry[i]);
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "biquad_cascade.h"
+#include "biquad_design.h"
+
+// Single section of BiquadCascade, usable as a Chain stage (see
+// circuits/chain.h).
+class Biquad : public BiquadCascade<1>
+{
+  public:
+    void setCoefficients(float b0, float b1, float b2, float a1, float a2)
+    {
+        setSection(0, b0, b1, b2, a1, a2);
+    }
+
+    void setCoefficients(const BiquadCoefficients& coefficients)
+    {
+        setSection(0, coefficients);
+    }
+
+    // Copies first or second order juce::dsp::IIR::Coefficients
+    template <typename Coefficients>
+    void setCoefficients(const Coefficients& coefficients)
+    {
+        setSection(0, coefficients);
+    }
+};
+
+// Second order Butterworth high-pass removing the offset of the tube and
+// diode stages.
+class DCBlock : public Biquad
+{
+  public:
+    void prepare(double sampleRate, float cutoff = 20.0f)
+    {
+        setCoefficients(rbj::highPass(sampleRate, cutoff));
+        reset();
+    }
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "../maths/simd.h"
+#include "biquad_design.h"
+
+#include <algorithm>
+#include <type_traits>
+
+// Series of N transposed direct form II biquads with the coefficients and
+// state stored inline as structure of arrays.
+//
+// processSample() runs the sections one after the other, unrolled.
+// process() evaluates all the sections at once with one section per SIMD
+// lane, as a pipeline: at step t lane k filters sample t - k, which lane
+// k - 1 produced at the step before. The pipeline is filled and drained
+// within every call, so there is no added latency and both functions can
+// be mixed freely.
+//
+// glide() moves the coefficients linearly to the ones given by setTarget()
+// over a number of samples. The stability region of a second order section
+// is convex in (a1, a2), so every coefficient set along the way is stable.
+template <int N> class BiquadCascade
+{
+  public:
+    static constexpr int num_sections = N;
+
+    BiquadCascade()
+    {
+        for (int k = 0; k < lanes; ++k)
+            setSection(k, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        reset();
+    }
+
+    void setSection(
+        int section, float b0, float b1, float b2, float a1, float a2
+    )
+    {
+        setTarget(section, BiquadCoefficients{b0, b1, b2, a1, a2});
+        current.set(section, target);
+        increment.set(section, Sections{});
+    }
+
+    void setSection(int section, const BiquadCoefficients& coefficients)
+    {
+        setSection(
+            section, coefficients.b0, coefficients.b1, coefficients.b2,
+            coefficients.a1, coefficients.a2
+        );
+    }
+
+    // Copies first or second order juce::dsp::IIR::Coefficients
+    template <typename Coefficients>
+    void setSection(int section, const Coefficients& coefficients)
+    {
+        const float* c = coefficients.getRawCoefficients();
+        if (coefficients.getFilterOrder() == 1)
+            setSection(section, c[0], c[1], 0.0f, c[2], 0.0f);
+        else
+            setSection(section, c[0], c[1], c[2], c[3], c[4]);
+    }
+
+    // Takes effect at the next glide()
+    void setTarget(int section, const BiquadCoefficients& coefficients)
+    {
+        target.b0[section] = coefficients.b0;
+        target.b1[section] = coefficients.b1;
+        target.b2[section] = coefficients.b2;
+        target.a1[section] = coefficients.a1;
+        target.a2[section] = coefficients.a2;
+    }
+
+    // Reaches the targets after numSamples samples, at once if zero
+    void glide(int numSamples)
+    {
+        glide_remaining = std::max(numSamples, 0);
+        if (glide_remaining == 0)
+        {
+            current = target;
+            return;
+        }
+        float scale = 1.0f / static_cast<float>(glide_remaining);
+        for (int k = 0; k < N; ++k)
+        {
+            increment.b0[k] = (target.b0[k] - current.b0[k]) * scale;
+            increment.b1[k] = (target.b1[k] - current.b1[k]) * scale;
+            increment.b2[k] = (target.b2[k] - current.b2[k]) * scale;
+            increment.a1[k] = (target.a1[k] - current.a1[k]) * scale;
+            increment.a2[k] = (target.a2[k] - current.a2[k]) * scale;
+        }
+    }
+
+    bool isGliding() const
+    {
+        return glide_remaining > 0;
+    }
+
+    void reset()
+    {
+        for (int k = 0; k < lanes; ++k)
+        {
+            s1[k] = 0.0f;
+            s2[k] = 0.0f;
+        }
+    }
+
+    float processSample(float x)
+    {
+        if (glide_remaining > 0)
+            advanceGlide();
+        for (int k = 0; k < N; ++k)
+        {
+            float y = current.b0[k] * x + s1[k];
+            s1[k] = current.b1[k] * x - current.a1[k] * y + s2[k];
+            s2[k] = current.b2[k] * x - current.a2[k] * y;
+            x = y;
+        }
+        return x;
+    }
+
+    void process(float* samples, int numSamples)
+    {
+        // The coefficients change every sample while gliding, which the
+        // pipeline cannot follow
+        int gliding = std::min(glide_remaining, numSamples);
+        for (int i = 0; i < gliding; ++i)
+            samples[i] = processSample(samples[i]);
+        samples += gliding;
+        numSamples -= gliding;
+
+        if constexpr (pipelined)
+        {
+            processPipelined(samples, numSamples);
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] = processSample(samples[i]);
+        }
+    }
+
+  private:
+    static constexpr bool pipelined =
+        simd::width > 1 && N > 1 && N <= simd::width;
+    // Unused lanes hold pass-through sections
+    static constexpr int lanes = pipelined ? simd::width : N;
+
+    struct Sections
+    {
+        float b0[lanes] = {};
+        float b1[lanes] = {};
+        float b2[lanes] = {};
+        float a1[lanes] = {};
+        float a2[lanes] = {};
+
+        void set(int k, const Sections& other)
+        {
+            b0[k] = other.b0[k];
+            b1[k] = other.b1[k];
+            b2[k] = other.b2[k];
+            a1[k] = other.a1[k];
+            a2[k] = other.a2[k];
+        }
+    };
+
+    void advanceGlide()
+    {
+        if (--glide_remaining == 0)
+        {
+            current = target;
+            return;
+        }
+        for (int k = 0; k < N; ++k)
+        {
+            current.b0[k] += increment.b0[k];
+            current.b1[k] += increment.b1[k];
+            current.b2[k] += increment.b2[k];
+            current.a1[k] += increment.a1[k];
+            current.a2[k] += increment.a2[k];
+        }
+    }
+
+    void processPipelined(float* samples, int numSamples)
+    {
+        using simd::vfloat;
+        if (numSamples <= 0)
+            return;
+
+        // Held in registers, samples could alias the members
+        const vfloat c0 = simd::load(current.b0);
+        const vfloat c1 = simd::load(current.b1);
+        const vfloat c2 = simd::load(current.b2);
+        const vfloat d1 = simd::load(current.a1);
+        const vfloat d2 = simd::load(current.a2);
+        vfloat state1 = simd::load(s1);
+        vfloat state2 = simd::load(s2);
+        vfloat u = simd::shiftLanesUp(vfloat(0.0f), samples[0]);
+
+        // One step of every lane, then lane k + 1 takes what lane k
+        // produced and lane 0 the next input. Returns the last section.
+        auto step = [&](float next, auto masked, simd::vmask active)
+        {
+            vfloat y = c0 * u + state1;
+            vfloat new1 = c1 * u - d1 * y + state2;
+            vfloat new2 = c2 * u - d2 * y;
+            if constexpr (decltype(masked)::value)
+            {
+                state1 = simd::select(active, new1, state1);
+                state2 = simd::select(active, new2, state2);
+            }
+            else
+            {
+                state1 = new1;
+                state2 = new2;
+            }
+            u = simd::shiftLanesUp(y, next);
+            return simd::extract<N - 1>(y);
+        };
+        const std::true_type masked;
+        const std::false_type unmasked;
+
+        float lane_index[lanes];
+        for (int k = 0; k < lanes; ++k)
+            lane_index[k] = static_cast<float>(k);
+        const vfloat index = simd::load(lane_index);
+
+        // Lane k is busy while 0 <= t - k < numSamples, so the first and
+        // last N - 1 steps only run part of the lanes.
+        const int latency = N - 1;
+        const int steps = numSamples + latency;
+        const float last = static_cast<float>(numSamples) - 0.5f;
+        auto input = [&](int t)
+        { return t < numSamples ? samples[t] : 0.0f; };
+
+        int t = 0;
+        for (; t < steps && (t < latency || t >= numSamples); ++t)
+        {
+            float tf = static_cast<float>(t);
+            simd::vmask active =
+                (index < vfloat(tf + 0.5f)) & (index > vfloat(tf - last));
+            float y = step(input(t + 1), masked, active);
+            if (t >= latency)
+                samples[t - latency] = y;
+        }
+        for (; t < numSamples; ++t)
+        {
+            samples[t - latency] =
+                step(input(t + 1), unmasked, simd::vmask{});
+        }
+        for (; t < steps; ++t)
+        {
+            float tf = static_cast<float>(t);
+            samples[t - latency] =
+                step(0.0f, masked, index > vfloat(tf - last));
+        }
+
+        simd::store(s1, state1);
+        simd::store(s2, state2);
+    }
+
+    Sections current;
+    Sections target;
+    Sections increment;
+    int glide_remaining = 0;
+    float s1[lanes];
+    float s2[lanes];
+};
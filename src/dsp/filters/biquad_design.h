@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Normalised coefficients of a second order section, a0 divided out
+struct BiquadCoefficients
+{
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+};
+
+// Closed form designs of the usual second order sections, with the same
+// formulas and arguments as the juce::dsp::IIR::Coefficients factories,
+// returned by value instead of in a heap allocated, reference counted
+// object. Cheap enough to run every block on the audio thread.
+namespace rbj
+{
+constexpr double pi = 3.14159265358979323846;
+constexpr double butterworth_q = 0.70710678118654752440;
+
+inline BiquadCoefficients normalise(
+    double b0, double b1, double b2, double a0, double a1, double a2
+)
+{
+    double inverse = 1.0 / a0;
+    return {static_cast<float>(b0 * inverse), static_cast<float>(b1 * inverse),
+            static_cast<float>(b2 * inverse), static_cast<float>(a1 * inverse),
+            static_cast<float>(a2 * inverse)};
+}
+
+inline BiquadCoefficients
+lowPass(double sampleRate, double frequency, double q = butterworth_q)
+{
+    double n = 1.0 / std::tan(pi * frequency / sampleRate);
+    double n2 = n * n;
+    double c1 = 1.0 / (1.0 + n / q + n2);
+    return {static_cast<float>(c1), static_cast<float>(2.0 * c1),
+            static_cast<float>(c1), static_cast<float>(c1 * 2.0 * (1.0 - n2)),
+            static_cast<float>(c1 * (1.0 - n / q + n2))};
+}
+
+inline BiquadCoefficients
+highPass(double sampleRate, double frequency, double q = butterworth_q)
+{
+    double n = std::tan(pi * frequency / sampleRate);
+    double n2 = n * n;
+    double c1 = 1.0 / (1.0 + n / q + n2);
+    return {static_cast<float>(c1), static_cast<float>(-2.0 * c1),
+            static_cast<float>(c1), static_cast<float>(c1 * 2.0 * (n2 - 1.0)),
+            static_cast<float>(c1 * (1.0 - n / q + n2))};
+}
+
+inline BiquadCoefficients
+allPass(double sampleRate, double frequency, double q = butterworth_q)
+{
+    double n = 1.0 / std::tan(pi * frequency / sampleRate);
+    double n2 = n * n;
+    double c1 = 1.0 / (1.0 + n / q + n2);
+    double b0 = c1 * (1.0 - n / q + n2);
+    double b1 = c1 * 2.0 * (1.0 - n2);
+    return {static_cast<float>(b0), static_cast<float>(b1), 1.0f,
+            static_cast<float>(b1), static_cast<float>(b0)};
+}
+
+// gain is linear, as for juce
+inline BiquadCoefficients lowShelf(
+    double sampleRate, double frequency, double q, double gain
+)
+{
+    double a = std::sqrt(std::max(gain, 0.0));
+    double omega = 2.0 * pi * std::max(frequency, 2.0) / sampleRate;
+    double cos_omega = std::cos(omega);
+    double beta = std::sin(omega) * std::sqrt(a) / q;
+    double a_minus_cos = (a - 1.0) * cos_omega;
+    return normalise(
+        a * (a + 1.0 - a_minus_cos + beta),
+        a * 2.0 * (a - 1.0 - (a + 1.0) * cos_omega),
+        a * (a + 1.0 - a_minus_cos - beta), a + 1.0 + a_minus_cos + beta,
+        -2.0 * (a - 1.0 + (a + 1.0) * cos_omega), a + 1.0 + a_minus_cos - beta
+    );
+}
+
+inline BiquadCoefficients highShelf(
+    double sampleRate, double frequency, double q, double gain
+)
+{
+    double a = std::sqrt(std::max(gain, 0.0));
+    double omega = 2.0 * pi * std::max(frequency, 2.0) / sampleRate;
+    double cos_omega = std::cos(omega);
+    double beta = std::sin(omega) * std::sqrt(a) / q;
+    double a_minus_cos = (a - 1.0) * cos_omega;
+    return normalise(
+        a * (a + 1.0 + a_minus_cos + beta),
+        a * -2.0 * (a - 1.0 + (a + 1.0) * cos_omega),
+        a * (a + 1.0 + a_minus_cos - beta), a + 1.0 - a_minus_cos + beta,
+        2.0 * (a - 1.0 - (a + 1.0) * cos_omega), a + 1.0 - a_minus_cos - beta
+    );
+}
+
+inline BiquadCoefficients
+peak(double sampleRate, double frequency, double q, double gain)
+{
+    double a = std::sqrt(std::max(gain, 0.0));
+    double omega = 2.0 * pi * std::max(frequency, 2.0) / sampleRate;
+    double alpha = std::sin(omega) / (2.0 * q);
+    double c2 = -2.0 * std::cos(omega);
+    return normalise(
+        1.0 + alpha * a, c2, 1.0 - alpha * a, 1.0 + alpha / a, c2,
+        1.0 - alpha / a
+    );
+}
+} // namespace rbj
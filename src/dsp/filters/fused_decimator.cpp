@@ -0,0 +1,201 @@
+#include "fused_decimator.h"
+
+#include <cmath>
+#include <complex>
+
+namespace
+{
+using complex = std::complex<double>;
+
+const double pi = 3.14159265358979323846;
+
+// In place radix 2 FFT, size has to be a power of two.
+void fft(std::vector<complex>& x, bool inverse)
+{
+    const size_t n = x.size();
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(x[i], x[j]);
+    }
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        double angle = (inverse ? 2.0 : -2.0) * pi / static_cast<double>(length);
+        complex rotation = std::polar(1.0, angle);
+        for (size_t start = 0; start < n; start += length)
+        {
+            complex w(1.0, 0.0);
+            for (size_t k = 0; k < length / 2; ++k)
+            {
+                complex even = x[start + k];
+                complex odd = x[start + k + length / 2] * w;
+                x[start + k] = even + odd;
+                x[start + k + length / 2] = even - odd;
+                w *= rotation;
+            }
+        }
+    }
+    if (inverse)
+    {
+        for (complex& v : x)
+            v /= static_cast<double>(n);
+    }
+}
+
+// Minimum phase impulse response with the given magnitude response,
+// sampled on fftSize / 2 + 1 bins, using the folded real cepstrum.
+std::vector<double> minimumPhase(const std::vector<double>& magnitude)
+{
+    const size_t half = magnitude.size() - 1;
+    const size_t n = 2 * half;
+    std::vector<complex> x(n);
+    for (size_t k = 0; k <= half; ++k)
+    {
+        x[k] = std::log(magnitude[k]);
+        if (k > 0 && k < half)
+            x[n - k] = x[k];
+    }
+
+    fft(x, true);
+    for (size_t i = 1; i < half; ++i)
+    {
+        x[i] = 2.0 * x[i].real();
+        x[n - i] = 0.0;
+    }
+    x[0] = x[0].real();
+    x[half] = x[half].real();
+
+    fft(x, false);
+    for (complex& v : x)
+        v = std::exp(v);
+    fft(x, true);
+
+    std::vector<double> h(n);
+    for (size_t i = 0; i < n; ++i)
+        h[i] = x[i].real();
+    return h;
+}
+} // namespace
+
+void FusedDecimator::prepare(
+    double outputSampleRate, int newFactor, int numTaps, double stopBandDb,
+    int maximumBlockSize
+)
+{
+    stop_band_floor = std::pow(10.0, stopBandDb / 20.0);
+    output_sample_rate = outputSampleRate;
+    factor = juce::jmax(newFactor, 1);
+    const int step = 4 * simd::width;
+    num_taps = juce::jmax((numTaps + step - 1) / step * step, step);
+    history.assign(
+        static_cast<size_t>(num_taps - 1 + factor * maximumBlockSize), 0.0f
+    );
+    design();
+}
+
+void FusedDecimator::setPostFilter(
+    juce::dsp::IIR::Coefficients<float>::Ptr coefficients
+)
+{
+    post_filter = coefficients;
+    design();
+}
+
+void FusedDecimator::reset()
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+}
+
+void FusedDecimator::design()
+{
+    const int fft_size = 4096;
+    const double input_sample_rate = output_sample_rate * factor;
+
+    std::vector<double> magnitude(fft_size / 2 + 1);
+    for (size_t k = 0; k < magnitude.size(); ++k)
+    {
+        double f = input_sample_rate * static_cast<double>(k) / fft_size;
+        double relative = f / output_sample_rate;
+
+        double band = 1.0;
+        if (relative >= stop_edge)
+            band = 0.0;
+        else if (relative > pass_edge)
+            band = 0.5 + 0.5 * std::cos(
+                                   pi * (relative - pass_edge) /
+                                   (stop_edge - pass_edge)
+                               );
+
+        double post = 1.0;
+        if (post_filter != nullptr)
+            post = post_filter->getMagnitudeForFrequency(f, input_sample_rate);
+
+        magnitude[k] = juce::jmax(band * post, stop_band_floor);
+    }
+
+    std::vector<double> h = minimumPhase(magnitude);
+
+    // Truncate with a fade over the last quarter, the minimum phase
+    // response has most of its energy at the start.
+    const int fade = num_taps / 4;
+    double sum = 0.0;
+    for (int i = 0; i < num_taps; ++i)
+    {
+        if (i >= num_taps - fade)
+        {
+            double t = static_cast<double>(i - (num_taps - fade) + 1) / fade;
+            h[i] *= 0.5 + 0.5 * std::cos(pi * t);
+        }
+        sum += h[i];
+    }
+    // Keep the DC gain exact
+    double scale = sum != 0.0 ? magnitude[0] / sum : 1.0;
+
+    reversed_taps.resize(num_taps);
+    for (int i = 0; i < num_taps; ++i)
+        reversed_taps[num_taps - 1 - i] = static_cast<float>(h[i] * scale);
+}
+
+void FusedDecimator::process(
+    const float* input, float* output, int numOutputSamples
+)
+{
+    const int num_input = numOutputSamples * factor;
+    jassert(num_taps - 1 + num_input <= static_cast<int>(history.size()));
+
+    float* x = history.data();
+    std::copy(input, input + num_input, x + num_taps - 1);
+
+    // Only every factor-th output of the filter is computed. Four sums of
+    // simd::width products each keep the multiply-adds from waiting on one
+    // another, num_taps is a multiple of 4 * simd::width.
+    const float* taps = reversed_taps.data();
+    const int step = 4 * simd::width;
+    alignas(32) float lanes[simd::width];
+    for (int n = 0; n < numOutputSamples; ++n)
+    {
+        const float* window = x + n * factor + factor - 1;
+        simd::vfloat acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+        for (int k = 0; k < num_taps; k += step)
+        {
+            const float* t = taps + k;
+            const float* w = window + k;
+            const int width = simd::width;
+            acc0 = acc0 + simd::load(t) * simd::load(w);
+            acc1 = acc1 + simd::load(t + width) * simd::load(w + width);
+            acc2 = acc2 + simd::load(t + 2 * width) * simd::load(w + 2 * width);
+            acc3 = acc3 + simd::load(t + 3 * width) * simd::load(w + 3 * width);
+        }
+        simd::store(lanes, (acc0 + acc1) + (acc2 + acc3));
+        float sum = 0.0f;
+        for (float lane : lanes)
+            sum += lane;
+        output[n] = sum;
+    }
+
+    std::copy(x + num_input, x + num_input + num_taps - 1, x);
+}
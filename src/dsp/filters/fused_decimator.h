@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../maths/simd.h"
+#include <juce_dsp/juce_dsp.h>
+#include <vector>
+
+// Integer factor decimator with a minimum phase FIR anti-aliasing filter.
+// The magnitude response of a linear filter running at the input rate
+// (typically the low-pass ending an oversampled nonlinear stage) can be
+// baked into the anti-aliasing filter, so both run as a single polyphase
+// filter computed at the output rate only.
+class FusedDecimator
+{
+  public:
+    // stopBandDb is the floor of the designed response, the truncation to
+    // numTaps leaves the aliases well above it: each overdrive picks both
+    // with scripts/cpp/decimator_bench.cpp. numTaps is rounded up to a
+    // multiple of 4 * simd::width.
+    void prepare(
+        double outputSampleRate, int factor, int numTaps, double stopBandDb,
+        int maximumBlockSize
+    );
+    void setPostFilter(
+        juce::dsp::IIR::Coefficients<float>::Ptr coefficients
+    );
+    void reset();
+
+    // Reads factor * numOutputSamples input samples.
+    void process(const float* input, float* output, int numOutputSamples);
+
+  private:
+    void design();
+
+    int num_taps = 32;
+    double stop_band_floor = 1e-5;
+    // Band edges relative to the output rate, anything folding back lands
+    // above the pass band edge.
+    static constexpr double pass_edge = 0.42;
+    static constexpr double stop_edge = 0.58;
+
+    double output_sample_rate = 44100.0;
+    int factor = 1;
+    juce::dsp::IIR::Coefficients<float>::Ptr post_filter;
+
+    // Taps in reverse order so that the filter is a plain dot product
+    // with the input history.
+    std::vector<float> reversed_taps;
+    std::vector<float> history;
+};
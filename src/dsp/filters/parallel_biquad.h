@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../maths/simd.h"
+#include "biquad_design.h"
+
+// Four independent transposed direct form II biquads, one per lane of a
+// simd::vfloat4, advancing together. Lanes default to pass-through, so a
+// few branches of different depths can be packed as layers of these.
+//
+// As for BiquadCascade, glide() moves every lane linearly to the
+// coefficients given by setTarget().
+class ParallelBiquad
+{
+  public:
+    static constexpr int num_lanes = 4;
+
+    // Immediate, also ends a glide of the other lanes
+    void setLane(int lane, float b0, float b1, float b2, float a1, float a2)
+    {
+        setTarget(lane, BiquadCoefficients{b0, b1, b2, a1, a2});
+        glide(0);
+    }
+
+    void setLane(int lane, const BiquadCoefficients& coefficients)
+    {
+        setTarget(lane, coefficients);
+        glide(0);
+    }
+
+    // Copies first or second order juce::dsp::IIR::Coefficients
+    template <typename Coefficients>
+    void setLane(int lane, const Coefficients& coefficients)
+    {
+        const float* c = coefficients.getRawCoefficients();
+        if (coefficients.getFilterOrder() == 1)
+            setLane(lane, c[0], c[1], 0.0f, c[2], 0.0f);
+        else
+            setLane(lane, c[0], c[1], c[2], c[3], c[4]);
+    }
+
+    // Takes effect at the next glide()
+    void setTarget(int lane, const BiquadCoefficients& coefficients)
+    {
+        b0[lane] = coefficients.b0;
+        b1[lane] = coefficients.b1;
+        b2[lane] = coefficients.b2;
+        a1[lane] = coefficients.a1;
+        a2[lane] = coefficients.a2;
+    }
+
+    // Reaches the targets after numSamples samples, at once if zero
+    void glide(int numSamples)
+    {
+        glide_remaining = numSamples > 0 ? numSamples : 0;
+        if (glide_remaining == 0)
+        {
+            c0 = simd::load4(b0);
+            c1 = simd::load4(b1);
+            c2 = simd::load4(b2);
+            d1 = simd::load4(a1);
+            d2 = simd::load4(a2);
+            return;
+        }
+        simd::vfloat4 scale(1.0f / static_cast<float>(glide_remaining));
+        dc0 = (simd::load4(b0) - c0) * scale;
+        dc1 = (simd::load4(b1) - c1) * scale;
+        dc2 = (simd::load4(b2) - c2) * scale;
+        dd1 = (simd::load4(a1) - d1) * scale;
+        dd2 = (simd::load4(a2) - d2) * scale;
+    }
+
+    void reset()
+    {
+        s1 = simd::vfloat4(0.0f);
+        s2 = simd::vfloat4(0.0f);
+    }
+
+    simd::vfloat4 processSample(simd::vfloat4 x)
+    {
+        if (glide_remaining > 0)
+            advanceGlide();
+        simd::vfloat4 y = c0 * x + s1;
+        s1 = c1 * x - d1 * y + s2;
+        s2 = c2 * x - d2 * y;
+        return y;
+    }
+
+  private:
+    void advanceGlide()
+    {
+        if (--glide_remaining == 0)
+        {
+            glide(0);
+            return;
+        }
+        c0 = c0 + dc0;
+        c1 = c1 + dc1;
+        c2 = c2 + dc2;
+        d1 = d1 + dd1;
+        d2 = d2 + dd2;
+    }
+
+    // Targets, the vectors below hold the coefficients in use
+    float b0[num_lanes] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float b1[num_lanes] = {};
+    float b2[num_lanes] = {};
+    float a1[num_lanes] = {};
+    float a2[num_lanes] = {};
+
+    simd::vfloat4 c0 = simd::vfloat4(1.0f);
+    simd::vfloat4 c1 = simd::vfloat4(0.0f);
+    simd::vfloat4 c2 = simd::vfloat4(0.0f);
+    simd::vfloat4 d1 = simd::vfloat4(0.0f);
+    simd::vfloat4 d2 = simd::vfloat4(0.0f);
+    simd::vfloat4 s1 = simd::vfloat4(0.0f);
+    simd::vfloat4 s2 = simd::vfloat4(0.0f);
+
+    simd::vfloat4 dc0 = simd::vfloat4(0.0f);
+    simd::vfloat4 dc1 = simd::vfloat4(0.0f);
+    simd::vfloat4 dc2 = simd::vfloat4(0.0f);
+    simd::vfloat4 dd1 = simd::vfloat4(0.0f);
+    simd::vfloat4 dd2 = simd::vfloat4(0.0f);
+    int glide_remaining = 0;
+};
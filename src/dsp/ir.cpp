@@ -1,72 +1,677 @@
 #include "ir.h"
+#include "dry_wet.h"
 
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_dsp/juce_dsp.h>
 
 void IRConvolver::prepare(const juce::dsp::ProcessSpec& spec)
 {
+    // Only what the new spec changes is redone: the same spec keeps the
+    // kernels, their history and the fitted model. The convolutions keep
+    // their IR through prepare().
+    bool rate_changed =
+        !juce::approximatelyEqual(spec.sampleRate, processSpec.sampleRate);
+    bool size_changed = spec.maximumBlockSize != processSpec.maximumBlockSize ||
+                        spec.numChannels != processSpec.numChannels;
+    if (!rate_changed && !size_changed)
+    {
+        return;
+    }
     processSpec = spec;
+    crossfadeBuffer.setSize(
+        static_cast<int>(spec.numChannels),
+        static_cast<int>(spec.maximumBlockSize)
+    );
+    foldBuffer.setSize(
+        static_cast<int>(spec.numChannels),
+        static_cast<int>(spec.maximumBlockSize)
+    );
+    convolution.prepare(spec);
+    folded_convolution.prepare(spec);
+    fold_state = FoldState::unfolded;
+    resetEngines();
+    engine_fade_length = juce::jmax(
+        1, juce::roundToInt(engine_fade_seconds * spec.sampleRate)
+    );
+
+    if (rate_changed && impulse_response != nullptr)
+    {
+        model_error_db = -1.0f;
+        fit_pool.addJob(
+            [this, ir = impulse_response, sampleRate = spec.sampleRate]
+            { fitModel(ir, sampleRate); }
+        );
+    }
+}
+
+void IRConvolver::process(juce::AudioBuffer<float>& buffer)
+{
+    processInParts(
+        buffer, [this](juce::AudioBuffer<float>& part) { processIR(part); }
+    );
 }
 
-void IRConvolver::applyGain(juce::AudioBuffer<float>& buffer)
+void IRConvolver::process(
+    juce::AudioBuffer<float>& buffer, AmpEQ& ampEQ, float masterGain
+)
 {
-    if (juce::approximatelyEqual(gain, previousGain))
+    processInParts(
+        buffer, [&](juce::AudioBuffer<float>& part)
+        { processFolding(part, ampEQ, masterGain); }
+    );
+}
+
+void IRConvolver::processFolding(
+    juce::AudioBuffer<float>& buffer, AmpEQ& ampEQ, float masterGain
+)
+{
+    loadBakedKernel();
+    bool foldable = fold_eq && !bypass && !eco && mix >= 1.0f &&
+                    !ampEQ.isBypassed() &&
+                    fold_baked.load() == fold_requested.load() &&
+                    ampEQ.isSettled();
+    const int numSamples = buffer.getNumSamples();
+
+    if (fold_state == FoldState::folded && foldable)
+    {
+        processFoldedKernel(buffer, masterGain);
+        return;
+    }
+    if (fold_state == FoldState::unfolded && !foldable)
     {
-        buffer.applyGain(gain);
+        processUnfolded(buffer, ampEQ, masterGain);
+        return;
+    }
+
+    // Transitions run both paths, the folded one on a copy of the input
+    int numChannels =
+        juce::jmin(buffer.getNumChannels(), foldBuffer.getNumChannels());
+    juce::AudioBuffer<float> folded(
+        foldBuffer.getArrayOfWritePointers(), numChannels, numSamples
+    );
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        folded.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+    }
+
+    if (fold_state == FoldState::folded)
+    {
+        // The EQ moved, or folding was turned off: the plain path was not
+        // fed while folded, it restarts from a cleared state and the
+        // folded kernel stays on until it is warm
+        resetEngines();
+        ampEQ.reset();
+        fold_state = FoldState::unfolding;
+        warmup_remaining = plainWarmupSamples(ampEQ);
+    }
+
+    if (fold_state == FoldState::unfolding)
+    {
+        processFoldedKernel(folded, masterGain);
+        if (foldable)
+        {
+            // Back before the plain path took over, it is dropped
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                buffer.copyFrom(channel, 0, folded, channel, 0, numSamples);
+            }
+            fold_state = FoldState::folded;
+            return;
+        }
+        processUnfolded(buffer, ampEQ, masterGain);
+        warmup_remaining -= numSamples;
+        float plain_end = warmup_remaining <= 0 ? 1.0f : 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float* plain = buffer.getWritePointer(channel);
+            mixDryWet(
+                plain, folded.getReadPointer(channel), plain, numSamples,
+                0.0f, plain_end, 1.0f, 1.0f
+            );
+        }
+        if (warmup_remaining <= 0)
+        {
+            fold_state = FoldState::unfolded;
+        }
+        return;
+    }
+
+    if (fold_state == FoldState::unfolded)
+    {
+        fold_state = FoldState::warming;
+        folded_ir_swapped = false;
+        folded_convolution.reset();
+    }
+
+    // Warming: the folded kernel is fed alongside the running chain until
+    // its new IR is in place and its history is filled
+    processUnfolded(buffer, ampEQ, masterGain);
+    if (!foldable)
+    {
+        fold_state = FoldState::unfolded;
+        return;
+    }
+    processFoldedKernel(folded, masterGain);
+
+    if (!folded_ir_swapped && kernel_generation == fold_requested.load())
+    {
+        // Also wait out the convolution's own crossfade to the new IR
+        folded_ir_swapped = true;
+        warmup_remaining = folded_convolution.getCurrentIRSize() +
+                           static_cast<int>(0.1 * processSpec.sampleRate);
+    }
+    if (folded_ir_swapped)
+    {
+        warmup_remaining -= numSamples;
+        if (warmup_remaining <= 0)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                buffer.applyGainRamp(channel, 0, numSamples, 1.0f, 0.0f);
+                folded.applyGainRamp(channel, 0, numSamples, 0.0f, 1.0f);
+                buffer.addFrom(channel, 0, folded, channel, 0, numSamples);
+            }
+            fold_state = FoldState::folded;
+        }
+    }
+}
+
+// Until the plain path sounds as if it had run all along: the EQ has rung
+// out and the engine has filled its history
+int IRConvolver::plainWarmupSamples(const AmpEQ& ampEQ) const
+{
+    int samples =
+        static_cast<int>(ampEQ.getTailSeconds() * processSpec.sampleRate);
+    if (!bypass && mix > 0.0f)
+    {
+        samples += convolution.getCurrentIRSize();
+    }
+    return samples;
+}
+
+void IRConvolver::processUnfolded(
+    juce::AudioBuffer<float>& buffer, AmpEQ& ampEQ, float masterGain
+)
+{
+    ampEQ.process(buffer);
+    if (juce::approximatelyEqual(masterGain, previousMasterGain))
+    {
+        buffer.applyGain(masterGain);
     }
     else
     {
-        buffer.applyGainRamp(0, buffer.getNumSamples(), previousGain, gain);
-        previousGain = gain;
+        buffer.applyGainRamp(
+            0, buffer.getNumSamples(), previousMasterGain, masterGain
+        );
+        previousMasterGain = masterGain;
     }
+    processIR(buffer);
 }
 
-void IRConvolver::process(juce::AudioBuffer<float>& buffer)
+void IRConvolver::processFoldedKernel(
+    juce::AudioBuffer<float>& buffer, float masterGain
+)
+{
+    juce::ScopedNoDenormals noDenormals;
+    juce::dsp::AudioBlock<float> block(buffer);
+    folded_convolution.process(
+        juce::dsp::ProcessContextReplacing<float>(block)
+    );
+
+    // The IR gain and the master gain collapse into a single gain stage
+    float foldedGain = gain * masterGain;
+    if (juce::approximatelyEqual(foldedGain, previousFoldedGain))
+    {
+        buffer.applyGain(foldedGain);
+    }
+    else
+    {
+        buffer.applyGainRamp(
+            0, buffer.getNumSamples(), previousFoldedGain, foldedGain
+        );
+        previousFoldedGain = foldedGain;
+    }
+}
+
+void IRConvolver::processIR(juce::AudioBuffer<float>& buffer)
 {
     if (bypass)
     {
         return;
     }
     juce::ScopedNoDenormals noDenormals;
+
+    {
+        const juce::SpinLock::ScopedTryLockType lock(model_lock);
+        if (lock.isLocked() && has_pending_model)
+        {
+            // The model heard goes on as the previous one, one warming up
+            // starts over as the refit
+            if (heard_engine == Engine::model)
+            {
+                previous_model = model;
+                std::memcpy(
+                    previous_model_state, model_state, sizeof(model_state)
+                );
+                heard_engine = Engine::previous_model;
+            }
+            if (incoming_engine == Engine::model)
+            {
+                incoming_engine = heard_engine;
+            }
+            model = pending_model;
+            has_pending_model = false;
+            std::memset(model_state, 0, sizeof(model_state));
+        }
+    }
+
+    // When only the dry signal is heard the engines do not run. When the
+    // mix comes back up the wanted one restarts from rest under the ramp,
+    // rather than replay the history it stopped with.
+    float mix_start = previous_mix;
+    previous_mix = mix;
+    if (mix_start <= 0.0f && mix <= 0.0f)
+    {
+        previousGain = gain;
+        return;
+    }
+
+    Engine wanted = eco && model.num_sections > 0 ? Engine::model
+                                                  : Engine::convolution;
+    if (mix_start <= 0.0f)
+    {
+        resetEngines();
+        heard_engine = wanted;
+        incoming_engine = wanted;
+    }
+    if (wanted == heard_engine)
+    {
+        incoming_engine = heard_engine;
+    }
+    else if (wanted != incoming_engine)
+    {
+        incoming_engine = wanted;
+        engine_position = 0;
+        engine_warmup_length = convolution.getCurrentIRSize();
+        if (wanted == Engine::model)
+        {
+            std::memset(model_state, 0, sizeof(model_state));
+            engine_warmup_length =
+                juce::jmin(engine_warmup_length, max_model_ir_length);
+        }
+        else
+        {
+            convolution.reset();
+        }
+    }
+    bool switching = incoming_engine != heard_engine;
+
+    // A fully wet block is processed in place, any other borrows its wet
+    // buffer from the scratch pool
+    bool in_place = !switching && mix_start >= 1.0f && mix >= 1.0f;
+    int wet_channels = buffer.getNumChannels();
+    if (!in_place)
+        wet_channels = juce::jmin(wet_channels, scratch->getNumChannels());
     juce::AudioBuffer<float> wetBuffer(
-        buffer.getNumChannels(), buffer.getNumSamples()
+        in_place ? buffer.getArrayOfWritePointers()
+                 : scratch->get(ScratchPool::dry),
+        wet_channels, buffer.getNumSamples()
     );
-    juce::dsp::AudioBlock<float> wetBlock(wetBuffer);
+
+    if (switching)
+    {
+        int numChannels = juce::jmin(
+            buffer.getNumChannels(), crossfadeBuffer.getNumChannels()
+        );
+        juce::AudioBuffer<float> incomingWet(
+            crossfadeBuffer.getArrayOfWritePointers(), numChannels,
+            buffer.getNumSamples()
+        );
+        processEngine(incoming_engine, buffer, incomingWet);
+        processEngine(heard_engine, buffer, wetBuffer);
+        crossfadeEngines(wetBuffer, incomingWet);
+    }
+    else
+    {
+        processEngine(heard_engine, buffer, wetBuffer);
+    }
+
+    // The gain only applies to the IR signal
+    for (int channel = 0; channel < wet_channels; ++channel)
+    {
+        auto* channelData = buffer.getWritePointer(channel);
+        mixDryWet(
+            channelData, channelData, wetBuffer.getReadPointer(channel),
+            buffer.getNumSamples(), mix_start, mix, previousGain, gain
+        );
+    }
+    previousGain = gain;
+}
+
+void IRConvolver::processEngine(
+    Engine engine, juce::AudioBuffer<float>& input,
+    juce::AudioBuffer<float>& output
+)
+{
+    switch (engine)
+    {
+    case Engine::convolution:
+        processConvolution(input, output);
+        break;
+    case Engine::model:
+        processModel(input, output, model, model_state);
+        break;
+    case Engine::previous_model:
+        processModel(input, output, previous_model, previous_model_state);
+        break;
+    }
+}
+
+void IRConvolver::resetEngines()
+{
+    convolution.reset();
+    std::memset(model_state, 0, sizeof(model_state));
+    heard_engine = Engine::convolution;
+    incoming_engine = Engine::convolution;
+}
+
+// The engines render the same IR, the fade is linear
+void IRConvolver::crossfadeEngines(
+    juce::AudioBuffer<float>& wet, const juce::AudioBuffer<float>& incoming
+)
+{
+    int numSamples = wet.getNumSamples();
+    int start = engine_position - engine_warmup_length;
+    engine_position += numSamples;
+    int end = engine_position - engine_warmup_length;
+    if (end <= 0)
+    {
+        return;
+    }
+    float mix_start =
+        static_cast<float>(juce::jmax(start, 0)) / engine_fade_length;
+    float mix_end =
+        juce::jmin(static_cast<float>(end) / engine_fade_length, 1.0f);
+    int numChannels =
+        juce::jmin(wet.getNumChannels(), incoming.getNumChannels());
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* samples = wet.getWritePointer(channel);
+        mixDryWet(
+            samples, samples, incoming.getReadPointer(channel), numSamples,
+            mix_start, mix_end, 1.0f, 1.0f
+        );
+    }
+    if (end >= engine_fade_length)
+    {
+        heard_engine = incoming_engine;
+    }
+}
+
+void IRConvolver::processConvolution(
+    juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output
+)
+{
+    juce::dsp::AudioBlock<float> wetBlock(output);
+    if (input.getReadPointer(0) == output.getReadPointer(0))
+    {
+        convolution.process(
+            juce::dsp::ProcessContextReplacing<float>(wetBlock)
+        );
+        return;
+    }
     juce::dsp::ProcessContextNonReplacing<float> context(
-        juce::dsp::AudioBlock<float>(buffer), wetBlock
+        juce::dsp::AudioBlock<float>(input), wetBlock
     );
     convolution.process(context);
+}
 
-    // Only apply gain to the IR signal
-    applyGain(wetBuffer);
-
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+void IRConvolver::processModel(
+    const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+    const IIRCascadeModel& cascade, ModelState& state
+)
+{
+    int numChannels = juce::jmin(output.getNumChannels(), 2);
+    for (int channel = 0; channel < numChannels; ++channel)
     {
-        auto* channelData = buffer.getWritePointer(channel);
-        auto* wetChannelData = wetBuffer.getReadPointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        if (output.getReadPointer(channel) != input.getReadPointer(channel))
         {
-            channelData[sample] = (channelData[sample] * (1.0f - mix)) +
-                                  (wetChannelData[sample] * mix);
+            output.copyFrom(
+                channel, 0, input, channel, 0, input.getNumSamples()
+            );
         }
+        auto* data = output.getWritePointer(channel);
+        for (int section = 0; section < cascade.num_sections; ++section)
+        {
+            const float* c = cascade.sections[section];
+            float s1 = state[channel][section][0];
+            float s2 = state[channel][section][1];
+            for (int i = 0; i < output.getNumSamples(); ++i)
+            {
+                float x = data[i];
+                float y = c[0] * x + s1;
+                s1 = c[1] * x - c[3] * y + s2;
+                s2 = c[2] * x - c[4] * y;
+                data[i] = y;
+            }
+            state[channel][section][0] = s1;
+            state[channel][section][1] = s2;
+        }
+        output.applyGain(channel, 0, output.getNumSamples(), cascade.gain);
     }
 }
 
-void IRConvolver::loadIR()
+bool IRConvolver::loadIR()
 {
-    juce::File file = juce::File(filepath);
-
-    if (!file.existsAsFile())
+    juce::File file(filepath);
+    if (impulse_response != nullptr && impulse_response->path == filepath &&
+        impulse_response->file_size == file.getSize() &&
+        impulse_response->modified == file.getLastModificationTime())
+    {
+        return false;
+    }
+    IRPointer loaded = readFile(filepath);
+    if (loaded == nullptr)
     {
         DBG("File does not exist: " + filepath);
-        return;
+        return false;
     }
+    impulse_response = loaded;
 
     convolution.loadImpulseResponse(
-        file, juce::dsp::Convolution::Stereo::yes,
-        juce::dsp::Convolution::Trim::no, 0,
+        juce::AudioBuffer<float>(loaded->samples), loaded->sample_rate,
+        juce::dsp::Convolution::Stereo::yes, juce::dsp::Convolution::Trim::no,
         juce::dsp::Convolution::Normalise::no
     );
-    convolution.prepare(processSpec);
     DBG("Loaded IR from file: " + filepath);
+    ir_seconds = loaded->samples.getNumSamples() / loaded->sample_rate;
+
+    model_error_db = -1.0f;
+    fit_pool.addJob([this, ir = loaded, sampleRate = processSpec.sampleRate]
+                    { fitModel(ir, sampleRate); });
+    return true;
+}
+
+IRConvolver::IRPointer IRConvolver::readFile(const juce::String& path)
+{
+    juce::File file(path);
+    if (!file.existsAsFile())
+    {
+        return nullptr;
+    }
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(
+        formatManager.createReaderFor(file)
+    );
+    if (reader == nullptr || reader->sampleRate <= 0.0)
+    {
+        return nullptr;
+    }
+
+    auto ir = std::make_shared<ImpulseResponse>();
+    ir->path = path;
+    ir->file_size = file.getSize();
+    ir->modified = file.getLastModificationTime();
+    ir->sample_rate = reader->sampleRate;
+    int numChannels = static_cast<int>(juce::jmin(reader->numChannels, 2u));
+    int length = static_cast<int>(reader->lengthInSamples);
+    ir->samples.setSize(numChannels, length);
+    reader->read(&ir->samples, 0, length, 0, true, numChannels > 1);
+    return ir;
+}
+
+// At most maxLength samples of the IR, at sampleRate
+juce::AudioBuffer<float> IRConvolver::readIR(
+    const ImpulseResponse& ir, double sampleRate, int maxLength
+)
+{
+    if (sampleRate <= 0.0)
+    {
+        return {};
+    }
+
+    int numChannels = ir.samples.getNumChannels();
+    int length = juce::jmin(ir.samples.getNumSamples(), maxLength);
+    if (juce::approximatelyEqual(ir.sample_rate, sampleRate))
+    {
+        juce::AudioBuffer<float> copy(numChannels, length);
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            copy.copyFrom(channel, 0, ir.samples, channel, 0, length);
+        }
+        return copy;
+    }
+
+    // The convolution resamples internally, anything derived from the IR
+    // has to be computed at the processing rate instead.
+    double ratio = ir.sample_rate / sampleRate;
+    int resampled_length = static_cast<int>((length - 4) / ratio);
+    juce::AudioBuffer<float> resampled(
+        numChannels, juce::jmax(resampled_length, 1)
+    );
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        juce::LagrangeInterpolator interpolator;
+        interpolator.process(
+            ratio, ir.samples.getReadPointer(channel),
+            resampled.getWritePointer(channel), resampled.getNumSamples()
+        );
+    }
+    return resampled;
+}
+
+void IRConvolver::fitModel(IRPointer ir, double sampleRate)
+{
+    juce::AudioBuffer<float> samples =
+        readIR(*ir, sampleRate, max_model_ir_length);
+    if (samples.getNumSamples() == 0)
+    {
+        return;
+    }
+
+    IIRCascadeModel fitted = fitWarpedLpc(
+        samples.getReadPointer(0), samples.getNumSamples(), sampleRate,
+        model_sections
+    );
+    DBG("Fitted IR model, spectral error (dB): " +
+        juce::String(fitted.error_db));
+
+    const juce::SpinLock::ScopedLockType lock(model_lock);
+    pending_model = fitted;
+    has_pending_model = true;
+    model_error_db = fitted.error_db;
+}
+
+void IRConvolver::foldEQ(const AmpEQ& ampEQ)
+{
+    if (!fold_eq || impulse_response == nullptr)
+    {
+        return;
+    }
+    // The gains are copied here, on the thread that sets them
+    int request = ++fold_requested;
+    fit_pool.addJob(
+        [this, gains = ampEQ.getGains(), ir = impulse_response,
+         sampleRate = processSpec.sampleRate,
+         request] { bakeFoldedIR(gains, ir, sampleRate, request); }
+    );
+}
+
+void IRConvolver::bakeFoldedIR(
+    AmpEQ::Gains gains, IRPointer source, double sampleRate, int request
+)
+{
+    if (request != fold_requested.load())
+    {
+        return;
+    }
+    juce::AudioBuffer<float> ir =
+        readIR(*source, sampleRate, static_cast<int>(10.0 * sampleRate));
+    if (ir.getNumSamples() == 0)
+    {
+        return;
+    }
+
+    // Leave room for the EQ to ring out, plus a spare sample the audio
+    // thread drops or keeps to set the length apart from the kernel in use
+    int tail = static_cast<int>(0.05 * sampleRate) + 1;
+    juce::AudioBuffer<float> folded(
+        ir.getNumChannels(), ir.getNumSamples() + tail
+    );
+    folded.clear();
+    for (int channel = 0; channel < ir.getNumChannels(); ++channel)
+    {
+        folded.copyFrom(channel, 0, ir, channel, 0, ir.getNumSamples());
+    }
+    AmpEQ::applySettledResponse(folded, sampleRate, gains);
+
+    if (request != fold_requested.load())
+    {
+        return;
+    }
+    // A kernel the audio thread has not taken yet is replaced, and freed
+    // here
+    const juce::SpinLock::ScopedLockType lock(baked_lock);
+    baked_kernel = std::move(folded);
+    has_baked_kernel = true;
+    fold_baked = request;
+}
+
+// Called on the audio thread, which the convolution allows for a buffer
+// allocated elsewhere. Nothing is loaded while a load is in flight.
+void IRConvolver::loadBakedKernel()
+{
+    if (loading_generation >= 0)
+    {
+        if (folded_convolution.getCurrentIRSize() != loading_size)
+        {
+            return;
+        }
+        kernel_generation = loading_generation;
+        loading_generation = -1;
+    }
+
+    const juce::SpinLock::ScopedTryLockType lock(baked_lock);
+    if (!lock.isLocked() || !has_baked_kernel)
+    {
+        return;
+    }
+    has_baked_kernel = false;
+    int length = baked_kernel.getNumSamples() - 1;
+    if (length == folded_convolution.getCurrentIRSize())
+    {
+        ++length;
+    }
+    // Shrinking keeps the allocation
+    baked_kernel.setSize(
+        baked_kernel.getNumChannels(), length, true, false, true
+    );
+    loading_size = length;
+    loading_generation = fold_baked.load();
+    folded_convolution.loadImpulseResponse(
+        std::move(baked_kernel), processSpec.sampleRate,
+        juce::dsp::Convolution::Stereo::yes, juce::dsp::Convolution::Trim::no,
+        juce::dsp::Convolution::Normalise::no
+    );
 }
@@ -1,16 +1,35 @@
 #pragma once
 
+#include "amp_eq.h"
+#include "maths/warped_lpc.h"
+#include "scratch_pool.h"
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
+#include <memory>
 
 class IRConvolver
 {
   public:
     void prepare(const juce::dsp::ProcessSpec& spec);
     void process(juce::AudioBuffer<float>& buffer);
+    // Runs the amp EQ, the amp master gain and the IR. When folding is
+    // enabled and the EQ has settled, the EQ and master gain are baked into
+    // a second kernel and the EQ filters stop running.
+    void process(
+        juce::AudioBuffer<float>& buffer, AmpEQ& ampEQ, float masterGain
+    );
+    // The EQ has to run through the process above until the plain chain
+    // has taken over again
+    bool isFolding() const
+    {
+        return fold_state != FoldState::unfolded;
+    }
+    // Bakes the settled response of the EQ into the IR in the background.
+    void foldEQ(const AmpEQ& ampEQ);
 
-    void loadIR();
-    void applyGain(juce::AudioBuffer<float>& buffer);
+    // Reads the file again only when the path, or the size or date of the
+    // file, changed. Returns whether a new IR was loaded.
+    bool loadIR();
     void setMix(float newMix)
     {
         mix = newMix;
@@ -23,6 +42,19 @@ class IRConvolver
     {
         bypass = newBypass;
     }
+    void setEco(bool shouldUseEco)
+    {
+        eco = shouldUseEco;
+    }
+    void setFoldEQ(bool shouldFoldEQ)
+    {
+        fold_eq = shouldFoldEQ;
+    }
+    // Holds the wet signal while it is mixed with the dry one
+    void setScratchPool(ScratchPool* pool)
+    {
+        scratch = pool;
+    }
     void setFilepath(juce::String newFilepath)
     {
         filepath = newFilepath;
@@ -31,17 +63,169 @@ class IRConvolver
     {
         return filepath;
     }
+    // Length of the loaded IR, none when bypassed
+    double getTailSeconds() const
+    {
+        return bypass ? 0.0 : ir_seconds.load();
+    }
+    // Spectral error of the eco approximation in dB, negative until a
+    // model has been fitted to the loaded IR.
+    float getModelErrorDb()
+    {
+        return model_error_db.load();
+    }
 
   private:
+    // The file as read, at its own rate. Shared with the background jobs,
+    // which derive the model and the folded kernel from it without going
+    // back to the disk. The size and date the file had tell whether it was
+    // rewritten since.
+    struct ImpulseResponse
+    {
+        juce::String path;
+        juce::int64 file_size = 0;
+        juce::Time modified;
+        juce::AudioBuffer<float> samples;
+        double sample_rate = 0.0;
+    };
+    using IRPointer = std::shared_ptr<const ImpulseResponse>;
+
+    static IRPointer readFile(const juce::String& path);
+    static juce::AudioBuffer<float> readIR(
+        const ImpulseResponse& ir, double sampleRate, int maxLength
+    );
+    void fitModel(IRPointer ir, double sampleRate);
+    void bakeFoldedIR(
+        AmpEQ::Gains gains, IRPointer ir, double sampleRate, int request
+    );
+    void processFolding(
+        juce::AudioBuffer<float>& buffer, AmpEQ& ampEQ, float masterGain
+    );
+    void processUnfolded(
+        juce::AudioBuffer<float>& buffer, AmpEQ& ampEQ, float masterGain
+    );
+    int plainWarmupSamples(const AmpEQ& ampEQ) const;
+    void processFoldedKernel(juce::AudioBuffer<float>& buffer, float masterGain);
+    void loadBakedKernel();
+
+    // Blocks longer than the host announced run in parts the transition
+    // buffers hold
+    template <typename Process>
+    void processInParts(juce::AudioBuffer<float>& buffer, Process process)
+    {
+        int length = juce::jmax(crossfadeBuffer.getNumSamples(), 1);
+        int numSamples = buffer.getNumSamples();
+        if (numSamples <= length)
+        {
+            process(buffer);
+            return;
+        }
+        for (int start = 0; start < numSamples; start += length)
+        {
+            juce::AudioBuffer<float> part(
+                buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                start, juce::jmin(length, numSamples - start)
+            );
+            process(part);
+        }
+    }
+    void processIR(juce::AudioBuffer<float>& buffer);
+    enum class Engine
+    {
+        convolution,
+        model,
+        previous_model // a refitted model replaced it
+    };
+    void processEngine(
+        Engine engine, juce::AudioBuffer<float>& input,
+        juce::AudioBuffer<float>& output
+    );
+    // Clears the engines, the convolution is heard next
+    void resetEngines();
+    void crossfadeEngines(
+        juce::AudioBuffer<float>& wet, const juce::AudioBuffer<float>& incoming
+    );
+    using ModelState = float[2][IIRCascadeModel::max_sections][2];
+    static void processModel(
+        const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+        const IIRCascadeModel& cascade, ModelState& state
+    );
+    void processConvolution(
+        juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output
+    );
+
     juce::dsp::ProcessSpec processSpec{-1, 0, 0};
 
     // GUI Parameters
     bool bypass = false;
+    bool eco = false;
     float mix = 1.0f;
     float gain = 1.0f;
     juce::String filepath;
 
     // Internal State
+    IRPointer impulse_response;
     float previousGain = 1.0f;
+    float previous_mix = 1.0f;
+    ScratchPool* scratch = nullptr;
     juce::dsp::Convolution convolution;
+    std::atomic<double> ir_seconds{0.0};
+
+    // Eco mode: biquad cascade fitted to the IR in the background
+    static constexpr int model_sections = 16;
+    static constexpr int max_model_ir_length = 16384;
+    IIRCascadeModel model;
+    IIRCascadeModel pending_model;
+    bool has_pending_model = false;
+    juce::SpinLock model_lock;
+    std::atomic<float> model_error_db{-1.0f};
+    ModelState model_state = {};
+    IIRCascadeModel previous_model;
+    ModelState previous_model_state = {};
+    // Switching between the convolution and its approximation, or to a
+    // refitted model: the incoming engine restarts from rest and is fed
+    // alongside the one heard for the length of the IR, then the two
+    // crossfade over engine_fade_seconds.
+    static constexpr double engine_fade_seconds = 0.025;
+    Engine heard_engine = Engine::convolution;
+    Engine incoming_engine = Engine::convolution;
+    int engine_warmup_length = 0;
+    int engine_fade_length = 1;
+    int engine_position = 0;
+    juce::AudioBuffer<float> crossfadeBuffer;
+
+    // EQ folding: the amp EQ and master gain baked into a second kernel.
+    // Every request is a generation. The pool thread bakes it and hands the
+    // kernel over, the audio thread loads the kernels one at a time and
+    // knows a load is in use once the convolution reports its length: a
+    // kernel is never loaded with the length of the one it replaces.
+    // Either way the incoming path is fed alongside the one heard until
+    // it has filled its history, then the two crossfade over a block.
+    enum class FoldState
+    {
+        unfolded,
+        warming,  // to the folded kernel
+        folded,
+        unfolding // back to the EQ and the plain kernel
+    };
+    bool fold_eq = false;
+    FoldState fold_state = FoldState::unfolded;
+    std::atomic<int> fold_requested{0};
+    std::atomic<int> fold_baked{-1};
+    juce::SpinLock baked_lock;
+    juce::AudioBuffer<float> baked_kernel;
+    bool has_baked_kernel = false;
+    int loading_generation = -1;
+    int loading_size = 0;
+    int kernel_generation = -1;
+    bool folded_ir_swapped = false;
+    int warmup_remaining = 0;
+    float previousMasterGain = 1.0f;
+    float previousFoldedGain = 1.0f;
+    juce::dsp::Convolution folded_convolution;
+    juce::AudioBuffer<float> foldBuffer;
+
+    // Declared last so that pending fits finish before anything else is
+    // destroyed
+    juce::ThreadPool fit_pool{1};
 };
@@ -0,0 +1,104 @@
+#pragma once
+
+// Branch-free approximations of the transcendental functions used in the
+// per-sample paths, as templates over float and simd::vfloat (see simd.h).
+//
+// Error bounds, checked by scripts/cpp/fast_math_check.cpp:
+//   exp2            3e-7 relative   (argument clamped to [-126, 127])
+//   exp             5e-6 relative for |x| <= 80, the rounding of x * log2(e)
+//                   dominates for large arguments
+//   log2, log10     2e-6 absolute   (argument clamped to >= 1e-30)
+//   tanh            2e-7 absolute
+//   decibelsToGain  1e-6 relative, 0 at or below -100 dB
+//   gainToDecibels  1e-5 dB, -100 dB floor
+// The -100 dB floor matches the juce::Decibels default.
+
+#include "simd.h"
+
+namespace fast_math
+{
+constexpr float exp2_max_relative_error = 3e-7f;
+constexpr float exp_max_relative_error = 5e-6f;
+constexpr float log2_max_error = 2e-6f;
+constexpr float tanh_max_error = 2e-7f;
+constexpr float decibels_to_gain_max_relative_error = 1e-6f;
+constexpr float gain_to_decibels_max_error = 1e-5f;
+constexpr float minus_infinity_db = -100.0f;
+
+template <typename F> inline F exp2(F x)
+{
+    using I = decltype(simd::asInt(x));
+    x = simd::min(simd::max(x, F(-126.0f)), F(127.0f));
+    // Round to nearest so that the remainder stays within [-0.5, 0.5]
+    F integer = simd::floor(x + 0.5f);
+    F f = x - integer;
+    F polynomial =
+        1.0f +
+        f * (0.6931471805599453f +
+             f * (0.2402265069591007f +
+                  f * (0.0555041086648216f +
+                       f * (0.0096181291076285f +
+                            f * (0.0013333558146428f +
+                                 f * 0.0001540353039338f)))));
+    I biased = simd::truncateToInt(integer) + I(127);
+    return polynomial * simd::asFloat(simd::shiftLeft<23>(biased));
+}
+
+template <typename F> inline F exp(F x)
+{
+    return exp2(x * 1.4426950408889634f);
+}
+
+template <typename F> inline F log2(F x)
+{
+    using I = decltype(simd::asInt(x));
+    I bits = simd::asInt(simd::max(x, F(1e-30f)));
+    I exponent_bits = bits & I(0x7f800000);
+    F exponent = simd::toFloat(simd::shiftRight<23>(exponent_bits) - I(127));
+    F mantissa = simd::asFloat((bits - exponent_bits) | I(0x3f800000));
+
+    // Centre the mantissa on 1 so the series below converges quickly
+    auto high = mantissa > 1.4142135623730951f;
+    mantissa = simd::select(high, mantissa * 0.5f, mantissa);
+    exponent = simd::select(high, exponent + 1.0f, exponent);
+
+    // log2(m) = 2 / ln(2) * atanh(t) with t = (m - 1) / (m + 1)
+    F t = (mantissa - 1.0f) / (mantissa + 1.0f);
+    F t2 = t * t;
+    F series =
+        t * (2.8853900817779268f +
+             t2 * (0.9617966939259756f +
+                   t2 * (0.5770780163555854f + t2 * 0.4121985831111324f)));
+    return exponent + series;
+}
+
+template <typename F> inline F log10(F x)
+{
+    return log2(x) * 0.3010299956639812f;
+}
+
+template <typename F> inline F tanh(F x)
+{
+    F a = simd::min(simd::abs(x), F(9.0f));
+    F e = exp2(a * 2.8853900817779268f);
+    F large = (e - 1.0f) / (e + 1.0f);
+    // The quotient cancels badly around 0, use the series there
+    F a2 = a * a;
+    F small = a * (1.0f + a2 * (-0.3333333333333333f +
+                                a2 * (0.1333333333333333f -
+                                      a2 * 0.0539682539682540f)));
+    F magnitude = simd::select(a < 0.125f, small, large);
+    return simd::select(x < 0.0f, -magnitude, magnitude);
+}
+
+template <typename F> inline F decibelsToGain(F db)
+{
+    F gain = exp2(db * 0.16609640474436813f);
+    return simd::select(db > minus_infinity_db, gain, F(0.0f));
+}
+
+template <typename F> inline F gainToDecibels(F gain)
+{
+    return simd::max(20.0f * log10(gain), F(minus_infinity_db));
+}
+} // namespace fast_math
@@ -0,0 +1,735 @@
+#pragma once
+
+// Minimal portable SIMD layer for the per-sample math kernels. One native
+// register type is picked at compile time (AVX2, SSE2, NEON or a plain
+// scalar fallback) and exposed as simd::vfloat / simd::vint / simd::vmask
+// with simd::width lanes.
+//
+// The same free functions are also defined for float / int32_t / bool, so
+// kernels written as templates over the float type compile both to scalar
+// and to vector code.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AURORA_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AURORA_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AURORA_SIMD_NEON 1
+#endif
+
+namespace simd
+{
+// Scalar versions, also used as the fallback
+
+inline float select(bool mask, float a, float b)
+{
+    return mask ? a : b;
+}
+inline int32_t select(bool mask, int32_t a, int32_t b)
+{
+    return mask ? a : b;
+}
+inline int32_t asInt(float x)
+{
+    int32_t i;
+    std::memcpy(&i, &x, sizeof(i));
+    return i;
+}
+inline float asFloat(int32_t i)
+{
+    float x;
+    std::memcpy(&x, &i, sizeof(x));
+    return x;
+}
+inline int32_t truncateToInt(float x)
+{
+    return static_cast<int32_t>(x);
+}
+inline float toFloat(int32_t i)
+{
+    return static_cast<float>(i);
+}
+inline float floor(float x)
+{
+    return std::floor(x);
+}
+inline float min(float a, float b)
+{
+    return std::min(a, b);
+}
+inline float max(float a, float b)
+{
+    return std::max(a, b);
+}
+inline float abs(float x)
+{
+    return std::abs(x);
+}
+inline float sqrt(float x)
+{
+    return std::sqrt(x);
+}
+template <int bits> inline int32_t shiftLeft(int32_t i)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(i) << bits);
+}
+template <int bits> inline int32_t shiftRight(int32_t i)
+{
+    return i >> bits;
+}
+
+#if defined(AURORA_SIMD_AVX2)
+
+constexpr int width = 8;
+
+struct vmask
+{
+    __m256 v;
+};
+struct vint
+{
+    __m256i v;
+    vint() = default;
+    vint(__m256i x) : v(x) {}
+    vint(int32_t x) : v(_mm256_set1_epi32(x)) {}
+};
+struct vfloat
+{
+    __m256 v;
+    vfloat() = default;
+    vfloat(__m256 x) : v(x) {}
+    vfloat(float x) : v(_mm256_set1_ps(x)) {}
+};
+
+inline vfloat load(const float* p)
+{
+    return _mm256_loadu_ps(p);
+}
+inline void store(float* p, vfloat x)
+{
+    _mm256_storeu_ps(p, x.v);
+}
+inline vfloat operator+(vfloat a, vfloat b)
+{
+    return _mm256_add_ps(a.v, b.v);
+}
+inline vfloat operator-(vfloat a, vfloat b)
+{
+    return _mm256_sub_ps(a.v, b.v);
+}
+inline vfloat operator*(vfloat a, vfloat b)
+{
+    return _mm256_mul_ps(a.v, b.v);
+}
+inline vfloat operator/(vfloat a, vfloat b)
+{
+    return _mm256_div_ps(a.v, b.v);
+}
+inline vfloat operator-(vfloat a)
+{
+    return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f));
+}
+inline vmask operator<(vfloat a, vfloat b)
+{
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+}
+inline vmask operator>(vfloat a, vfloat b)
+{
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};
+}
+inline vmask operator&(vmask a, vmask b)
+{
+    return {_mm256_and_ps(a.v, b.v)};
+}
+inline vfloat select(vmask m, vfloat a, vfloat b)
+{
+    return _mm256_blendv_ps(b.v, a.v, m.v);
+}
+inline vint select(vmask m, vint a, vint b)
+{
+    return _mm256_castps_si256(_mm256_blendv_ps(
+        _mm256_castsi256_ps(b.v), _mm256_castsi256_ps(a.v), m.v
+    ));
+}
+inline vfloat min(vfloat a, vfloat b)
+{
+    return _mm256_min_ps(a.v, b.v);
+}
+inline vfloat max(vfloat a, vfloat b)
+{
+    return _mm256_max_ps(a.v, b.v);
+}
+inline vfloat abs(vfloat x)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x.v);
+}
+inline vfloat floor(vfloat x)
+{
+    return _mm256_floor_ps(x.v);
+}
+inline vfloat sqrt(vfloat x)
+{
+    return _mm256_sqrt_ps(x.v);
+}
+inline vint asInt(vfloat x)
+{
+    return _mm256_castps_si256(x.v);
+}
+inline vfloat asFloat(vint i)
+{
+    return _mm256_castsi256_ps(i.v);
+}
+inline vint truncateToInt(vfloat x)
+{
+    return _mm256_cvttps_epi32(x.v);
+}
+inline vfloat toFloat(vint i)
+{
+    return _mm256_cvtepi32_ps(i.v);
+}
+inline vint operator+(vint a, vint b)
+{
+    return _mm256_add_epi32(a.v, b.v);
+}
+inline vint operator-(vint a, vint b)
+{
+    return _mm256_sub_epi32(a.v, b.v);
+}
+inline vint operator&(vint a, vint b)
+{
+    return _mm256_and_si256(a.v, b.v);
+}
+inline vint operator|(vint a, vint b)
+{
+    return _mm256_or_si256(a.v, b.v);
+}
+template <int bits> inline vint shiftLeft(vint i)
+{
+    return _mm256_slli_epi32(i.v, bits);
+}
+template <int bits> inline vint shiftRight(vint i)
+{
+    return _mm256_srai_epi32(i.v, bits);
+}
+// {first, x[0], ..., x[width - 2]}
+inline vfloat shiftLanesUp(vfloat x, float first)
+{
+    __m256 shifted = _mm256_permutevar8x32_ps(
+        x.v, _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6)
+    );
+    return _mm256_blend_ps(shifted, _mm256_set1_ps(first), 1);
+}
+template <int lane> inline float extract(vfloat x)
+{
+    return _mm256_cvtss_f32(
+        _mm256_permutevar8x32_ps(x.v, _mm256_set1_epi32(lane))
+    );
+}
+
+#elif defined(AURORA_SIMD_SSE2)
+
+constexpr int width = 4;
+
+struct vmask
+{
+    __m128 v;
+};
+struct vint
+{
+    __m128i v;
+    vint() = default;
+    vint(__m128i x) : v(x) {}
+    vint(int32_t x) : v(_mm_set1_epi32(x)) {}
+};
+struct vfloat
+{
+    __m128 v;
+    vfloat() = default;
+    vfloat(__m128 x) : v(x) {}
+    vfloat(float x) : v(_mm_set1_ps(x)) {}
+};
+
+inline vfloat load(const float* p)
+{
+    return _mm_loadu_ps(p);
+}
+inline void store(float* p, vfloat x)
+{
+    _mm_storeu_ps(p, x.v);
+}
+inline vfloat operator+(vfloat a, vfloat b)
+{
+    return _mm_add_ps(a.v, b.v);
+}
+inline vfloat operator-(vfloat a, vfloat b)
+{
+    return _mm_sub_ps(a.v, b.v);
+}
+inline vfloat operator*(vfloat a, vfloat b)
+{
+    return _mm_mul_ps(a.v, b.v);
+}
+inline vfloat operator/(vfloat a, vfloat b)
+{
+    return _mm_div_ps(a.v, b.v);
+}
+inline vfloat operator-(vfloat a)
+{
+    return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f));
+}
+inline vmask operator<(vfloat a, vfloat b)
+{
+    return {_mm_cmplt_ps(a.v, b.v)};
+}
+inline vmask operator>(vfloat a, vfloat b)
+{
+    return {_mm_cmpgt_ps(a.v, b.v)};
+}
+inline vmask operator&(vmask a, vmask b)
+{
+    return {_mm_and_ps(a.v, b.v)};
+}
+inline vfloat select(vmask m, vfloat a, vfloat b)
+{
+    return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v));
+}
+inline vint select(vmask m, vint a, vint b)
+{
+    __m128i mi = _mm_castps_si128(m.v);
+    return _mm_or_si128(_mm_and_si128(mi, a.v), _mm_andnot_si128(mi, b.v));
+}
+inline vfloat min(vfloat a, vfloat b)
+{
+    return _mm_min_ps(a.v, b.v);
+}
+inline vfloat max(vfloat a, vfloat b)
+{
+    return _mm_max_ps(a.v, b.v);
+}
+inline vfloat abs(vfloat x)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), x.v);
+}
+inline vfloat sqrt(vfloat x)
+{
+    return _mm_sqrt_ps(x.v);
+}
+inline vint asInt(vfloat x)
+{
+    return _mm_castps_si128(x.v);
+}
+inline vfloat asFloat(vint i)
+{
+    return _mm_castsi128_ps(i.v);
+}
+inline vint truncateToInt(vfloat x)
+{
+    return _mm_cvttps_epi32(x.v);
+}
+inline vfloat toFloat(vint i)
+{
+    return _mm_cvtepi32_ps(i.v);
+}
+inline vfloat floor(vfloat x)
+{
+    // No rounding instructions before SSE4.1
+    vfloat t = toFloat(truncateToInt(x));
+    return t - select(x < t, vfloat(1.0f), vfloat(0.0f));
+}
+inline vint operator+(vint a, vint b)
+{
+    return _mm_add_epi32(a.v, b.v);
+}
+inline vint operator-(vint a, vint b)
+{
+    return _mm_sub_epi32(a.v, b.v);
+}
+inline vint operator&(vint a, vint b)
+{
+    return _mm_and_si128(a.v, b.v);
+}
+inline vint operator|(vint a, vint b)
+{
+    return _mm_or_si128(a.v, b.v);
+}
+template <int bits> inline vint shiftLeft(vint i)
+{
+    return _mm_slli_epi32(i.v, bits);
+}
+template <int bits> inline vint shiftRight(vint i)
+{
+    return _mm_srai_epi32(i.v, bits);
+}
+inline vfloat shiftLanesUp(vfloat x, float first)
+{
+    __m128 shifted = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x.v), 4));
+    return _mm_move_ss(shifted, _mm_set_ss(first));
+}
+template <int lane> inline float extract(vfloat x)
+{
+    return _mm_cvtss_f32(
+        _mm_shuffle_ps(x.v, x.v, _MM_SHUFFLE(lane, lane, lane, lane))
+    );
+}
+
+#elif defined(AURORA_SIMD_NEON)
+
+constexpr int width = 4;
+
+struct vmask
+{
+    uint32x4_t v;
+};
+struct vint
+{
+    int32x4_t v;
+    vint() = default;
+    vint(int32x4_t x) : v(x) {}
+    vint(int32_t x) : v(vdupq_n_s32(x)) {}
+};
+struct vfloat
+{
+    float32x4_t v;
+    vfloat() = default;
+    vfloat(float32x4_t x) : v(x) {}
+    vfloat(float x) : v(vdupq_n_f32(x)) {}
+};
+
+inline vfloat load(const float* p)
+{
+    return vld1q_f32(p);
+}
+inline void store(float* p, vfloat x)
+{
+    vst1q_f32(p, x.v);
+}
+inline vfloat operator+(vfloat a, vfloat b)
+{
+    return vaddq_f32(a.v, b.v);
+}
+inline vfloat operator-(vfloat a, vfloat b)
+{
+    return vsubq_f32(a.v, b.v);
+}
+inline vfloat operator*(vfloat a, vfloat b)
+{
+    return vmulq_f32(a.v, b.v);
+}
+inline vfloat operator/(vfloat a, vfloat b)
+{
+    // Two Newton steps on the reciprocal estimate
+    float32x4_t r = vrecpeq_f32(b.v);
+    r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+    r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+    return vmulq_f32(a.v, r);
+}
+inline vfloat operator-(vfloat a)
+{
+    return vnegq_f32(a.v);
+}
+inline vmask operator<(vfloat a, vfloat b)
+{
+    return {vcltq_f32(a.v, b.v)};
+}
+inline vmask operator>(vfloat a, vfloat b)
+{
+    return {vcgtq_f32(a.v, b.v)};
+}
+inline vmask operator&(vmask a, vmask b)
+{
+    return {vandq_u32(a.v, b.v)};
+}
+inline vfloat select(vmask m, vfloat a, vfloat b)
+{
+    return vbslq_f32(m.v, a.v, b.v);
+}
+inline vint select(vmask m, vint a, vint b)
+{
+    return vbslq_s32(m.v, a.v, b.v);
+}
+inline vfloat min(vfloat a, vfloat b)
+{
+    return vminq_f32(a.v, b.v);
+}
+inline vfloat max(vfloat a, vfloat b)
+{
+    return vmaxq_f32(a.v, b.v);
+}
+inline vfloat abs(vfloat x)
+{
+    return vabsq_f32(x.v);
+}
+inline vfloat sqrt(vfloat x)
+{
+#if defined(__aarch64__)
+    return vsqrtq_f32(x.v);
+#else
+    float32x4_t r = vrsqrteq_f32(x.v);
+    r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x.v, r), r), r);
+    r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(x.v, r), r), r);
+    return vbslq_f32(vceqq_f32(x.v, vdupq_n_f32(0.0f)), x.v, vmulq_f32(x.v, r));
+#endif
+}
+inline vint asInt(vfloat x)
+{
+    return vreinterpretq_s32_f32(x.v);
+}
+inline vfloat asFloat(vint i)
+{
+    return vreinterpretq_f32_s32(i.v);
+}
+inline vint truncateToInt(vfloat x)
+{
+    return vcvtq_s32_f32(x.v);
+}
+inline vfloat toFloat(vint i)
+{
+    return vcvtq_f32_s32(i.v);
+}
+inline vfloat floor(vfloat x)
+{
+    vfloat t = toFloat(truncateToInt(x));
+    return t - select(x < t, vfloat(1.0f), vfloat(0.0f));
+}
+inline vint operator+(vint a, vint b)
+{
+    return vaddq_s32(a.v, b.v);
+}
+inline vint operator-(vint a, vint b)
+{
+    return vsubq_s32(a.v, b.v);
+}
+inline vint operator&(vint a, vint b)
+{
+    return vandq_s32(a.v, b.v);
+}
+inline vint operator|(vint a, vint b)
+{
+    return vorrq_s32(a.v, b.v);
+}
+template <int bits> inline vint shiftLeft(vint i)
+{
+    return vshlq_n_s32(i.v, bits);
+}
+template <int bits> inline vint shiftRight(vint i)
+{
+    return vshrq_n_s32(i.v, bits);
+}
+inline vfloat shiftLanesUp(vfloat x, float first)
+{
+    return vextq_f32(vdupq_n_f32(first), x.v, 3);
+}
+template <int lane> inline float extract(vfloat x)
+{
+    return vgetq_lane_f32(x.v, lane);
+}
+
+#else
+
+constexpr int width = 1;
+
+using vmask = bool;
+using vint = int32_t;
+using vfloat = float;
+
+inline vfloat load(const float* p)
+{
+    return *p;
+}
+inline void store(float* p, vfloat x)
+{
+    *p = x;
+}
+inline vfloat shiftLanesUp(vfloat, float first)
+{
+    return first;
+}
+template <int lane> inline float extract(vfloat x)
+{
+    return x;
+}
+
+#endif
+
+// Four lanes whatever the native width, to pack a few independent
+// filters or detectors side by side. Only the arithmetic those need is
+// defined.
+#if defined(AURORA_SIMD_AVX2)
+
+struct vfloat4
+{
+    __m128 v;
+    vfloat4() = default;
+    vfloat4(__m128 x) : v(x) {}
+    vfloat4(float x) : v(_mm_set1_ps(x)) {}
+};
+
+inline vfloat4 load4(const float* p)
+{
+    return _mm_loadu_ps(p);
+}
+inline void store4(float* p, vfloat4 x)
+{
+    _mm_storeu_ps(p, x.v);
+}
+inline vfloat4 set4(float a, float b, float c, float d)
+{
+    return _mm_setr_ps(a, b, c, d);
+}
+inline vfloat4 operator+(vfloat4 a, vfloat4 b)
+{
+    return _mm_add_ps(a.v, b.v);
+}
+inline vfloat4 operator-(vfloat4 a, vfloat4 b)
+{
+    return _mm_sub_ps(a.v, b.v);
+}
+inline vfloat4 operator*(vfloat4 a, vfloat4 b)
+{
+    return _mm_mul_ps(a.v, b.v);
+}
+
+struct vmask4
+{
+    __m128 v;
+};
+inline vmask4 operator>(vfloat4 a, vfloat4 b)
+{
+    return {_mm_cmpgt_ps(a.v, b.v)};
+}
+inline vfloat4 select(vmask4 m, vfloat4 a, vfloat4 b)
+{
+    return _mm_blendv_ps(b.v, a.v, m.v);
+}
+inline vfloat4 max(vfloat4 a, vfloat4 b)
+{
+    return _mm_max_ps(a.v, b.v);
+}
+inline vfloat4 abs(vfloat4 x)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), x.v);
+}
+inline vfloat4 sqrt(vfloat4 x)
+{
+    return _mm_sqrt_ps(x.v);
+}
+
+#elif defined(AURORA_SIMD_SSE2) || defined(AURORA_SIMD_NEON)
+
+using vfloat4 = vfloat;
+using vmask4 = vmask;
+
+inline vfloat4 load4(const float* p)
+{
+    return load(p);
+}
+inline void store4(float* p, vfloat4 x)
+{
+    store(p, x);
+}
+// Built in registers, going through memory would stall on store forwarding
+inline vfloat4 set4(float a, float b, float c, float d)
+{
+#if defined(AURORA_SIMD_SSE2)
+    return _mm_setr_ps(a, b, c, d);
+#else
+    float32x4_t x = vdupq_n_f32(a);
+    x = vsetq_lane_f32(b, x, 1);
+    x = vsetq_lane_f32(c, x, 2);
+    return vsetq_lane_f32(d, x, 3);
+#endif
+}
+
+#else
+
+struct vfloat4
+{
+    float v[4];
+    vfloat4() = default;
+    vfloat4(float x) : v{x, x, x, x} {}
+};
+
+inline vfloat4 set4(float a, float b, float c, float d)
+{
+    vfloat4 x;
+    x.v[0] = a;
+    x.v[1] = b;
+    x.v[2] = c;
+    x.v[3] = d;
+    return x;
+}
+inline vfloat4 load4(const float* p)
+{
+    return set4(p[0], p[1], p[2], p[3]);
+}
+inline void store4(float* p, vfloat4 x)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = x.v[i];
+}
+inline vfloat4 operator+(vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i)
+        a.v[i] += b.v[i];
+    return a;
+}
+inline vfloat4 operator-(vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i)
+        a.v[i] -= b.v[i];
+    return a;
+}
+inline vfloat4 operator*(vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i)
+        a.v[i] *= b.v[i];
+    return a;
+}
+
+struct vmask4
+{
+    bool v[4];
+};
+inline vmask4 operator>(vfloat4 a, vfloat4 b)
+{
+    vmask4 m;
+    for (int i = 0; i < 4; ++i)
+        m.v[i] = a.v[i] > b.v[i];
+    return m;
+}
+inline vfloat4 select(vmask4 m, vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i)
+        a.v[i] = m.v[i] ? a.v[i] : b.v[i];
+    return a;
+}
+inline vfloat4 max(vfloat4 a, vfloat4 b)
+{
+    for (int i = 0; i < 4; ++i)
+        a.v[i] = std::max(a.v[i], b.v[i]);
+    return a;
+}
+inline vfloat4 abs(vfloat4 x)
+{
+    for (int i = 0; i < 4; ++i)
+        x.v[i] = std::abs(x.v[i]);
+    return x;
+}
+inline vfloat4 sqrt(vfloat4 x)
+{
+    for (int i = 0; i < 4; ++i)
+        x.v[i] = std::sqrt(x.v[i]);
+    return x;
+}
+
+#endif
+} // namespace simd
@@ -0,0 +1,294 @@
+#include "warped_lpc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace
+{
+using complex = std::complex<double>;
+
+const double pi = 3.14159265358979323846;
+
+// Autocorrelation of the impulse response against successive first order
+// allpass filtered copies of itself, which is the autocorrelation on the
+// warped frequency axis.
+std::vector<double> warpedAutocorrelation(
+    const std::vector<double>& x, int order, double lambda
+)
+{
+    std::vector<double> r(order + 1, 0.0);
+    std::vector<double> previous = x;
+    std::vector<double> current(x.size());
+
+    for (double v : x)
+        r[0] += v * v;
+
+    for (int k = 1; k <= order; ++k)
+    {
+        double x1 = 0.0;
+        double y1 = 0.0;
+        for (size_t n = 0; n < x.size(); ++n)
+        {
+            double y = -lambda * previous[n] + x1 + lambda * y1;
+            x1 = previous[n];
+            y1 = y;
+            current[n] = y;
+            r[k] += x[n] * y;
+        }
+        std::swap(previous, current);
+    }
+    return r;
+}
+
+// Levinson-Durbin recursion, returns a[0..order] with a[0] = 1.
+std::vector<double> levinson(const std::vector<double>& r, int order)
+{
+    std::vector<double> a(order + 1, 0.0);
+    std::vector<double> tmp(order + 1, 0.0);
+    a[0] = 1.0;
+    double error = r[0];
+
+    for (int i = 1; i <= order && error > 0.0; ++i)
+    {
+        double acc = r[i];
+        for (int j = 1; j < i; ++j)
+            acc += a[j] * r[i - j];
+        double k = -acc / error;
+
+        tmp = a;
+        for (int j = 1; j < i; ++j)
+            a[j] = tmp[j] + k * tmp[i - j];
+        a[i] = k;
+        error *= (1.0 - k * k);
+    }
+    return a;
+}
+
+// Durand-Kerner iteration on the monic polynomial
+// z^n + a[1] z^(n-1) + ... + a[n].
+std::vector<complex> polynomialRoots(const std::vector<double>& a)
+{
+    const int n = static_cast<int>(a.size()) - 1;
+    std::vector<complex> roots(n);
+    const complex seed(0.4, 0.9);
+    roots[0] = complex(1.0, 0.0);
+    for (int k = 1; k < n; ++k)
+        roots[k] = roots[k - 1] * seed;
+
+    for (int iteration = 0; iteration < 2000; ++iteration)
+    {
+        double max_step = 0.0;
+        for (int k = 0; k < n; ++k)
+        {
+            complex value(1.0, 0.0);
+            for (int j = 1; j <= n; ++j)
+                value = value * roots[k] + a[j];
+
+            complex denominator(1.0, 0.0);
+            for (int j = 0; j < n; ++j)
+                if (j != k)
+                    denominator *= roots[k] - roots[j];
+
+            complex step = value / denominator;
+            roots[k] -= step;
+            max_step = std::max(max_step, std::abs(step));
+        }
+        if (max_step < 1e-13)
+            break;
+    }
+    return roots;
+}
+
+complex sectionResponse(const float* s, complex z1)
+{
+    complex z2 = z1 * z1;
+    complex num = double(s[0]) + double(s[1]) * z1 + double(s[2]) * z2;
+    complex den = 1.0 + double(s[3]) * z1 + double(s[4]) * z2;
+    return num / den;
+}
+
+double modelPower(const IIRCascadeModel& model, double omega)
+{
+    complex z1 = std::polar(1.0, -omega);
+    complex h(1.0, 0.0);
+    for (int i = 0; i < model.num_sections; ++i)
+        h *= sectionResponse(model.sections[i], z1);
+    return std::norm(h);
+}
+
+double impulsePower(const std::vector<double>& x, double omega)
+{
+    const complex rotation = std::polar(1.0, -omega);
+    complex phasor(1.0, 0.0);
+    complex h(0.0, 0.0);
+    for (double v : x)
+    {
+        h += v * phasor;
+        phasor *= rotation;
+    }
+    return std::norm(h);
+}
+
+// Power averaged over a 1/6 octave band around each centre frequency.
+template <typename PowerFunction>
+std::vector<double> smoothedSpectrumDb(
+    const std::vector<double>& centres, double sampleRate, PowerFunction power
+)
+{
+    const int points_per_band = 8;
+    std::vector<double> spectrum;
+    spectrum.reserve(centres.size());
+    for (double centre : centres)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < points_per_band; ++i)
+        {
+            double offset = (i + 0.5) / points_per_band - 0.5;
+            double f = centre * std::pow(2.0, offset / 6.0);
+            sum += power(2.0 * pi * f / sampleRate);
+        }
+        spectrum.push_back(10.0 * std::log10(sum / points_per_band + 1e-300));
+    }
+    return spectrum;
+}
+} // namespace
+
+float warpingFactor(double sampleRate)
+{
+    // Smith & Abel Bark warping approximation.
+    return static_cast<float>(
+        1.0674 * std::sqrt(2.0 / pi * std::atan(0.06583 * sampleRate / 1000.0)) -
+        0.1916
+    );
+}
+
+IIRCascadeModel fitWarpedLpc(
+    const float* ir, int length, double sampleRate, int numSections
+)
+{
+    IIRCascadeModel model;
+    numSections = std::clamp(numSections, 1, IIRCascadeModel::max_sections);
+    if (ir == nullptr || length <= 2 * numSections)
+        return model;
+
+    const int order = 2 * numSections;
+    const double lambda = warpingFactor(sampleRate);
+
+    // Leave room for the allpass chain to ring out past the end of the IR
+    std::vector<double> x(static_cast<size_t>(length + length / 2 + 512), 0.0);
+    for (int i = 0; i < length; ++i)
+        x[i] = ir[i];
+
+    std::vector<double> r = warpedAutocorrelation(x, order, lambda);
+    if (r[0] <= 0.0)
+        return model;
+    // -60dB white noise correction keeps the recursion well conditioned
+    r[0] *= 1.0 + 1e-6;
+
+    std::vector<double> a = levinson(r, order);
+    std::vector<complex> warped_poles = polynomialRoots(a);
+
+    // De-warp the poles: 1 - p D(z) = (1 + p lambda)(1 - q z^-1) / (1 -
+    // lambda z^-1) with q = (p + lambda) / (1 + p lambda). The warped
+    // all-pole model then has order - 1 zeros at lambda once the
+    // (1 - lambda z^-1) jacobian of the warping is compensated.
+    std::vector<complex> complex_poles;
+    std::vector<double> real_poles;
+    for (const complex& p : warped_poles)
+    {
+        complex q = (p + lambda) / (1.0 + lambda * p);
+        if (std::abs(q) >= 0.99999)
+            q *= 0.99999 / std::abs(q);
+        if (q.imag() > 1e-9)
+            complex_poles.push_back(q);
+        else if (std::abs(q.imag()) <= 1e-9)
+            real_poles.push_back(q.real());
+    }
+    std::sort(real_poles.begin(), real_poles.end());
+
+    struct PoleSection
+    {
+        double a1;
+        double a2;
+        double radius;
+    };
+    std::vector<PoleSection> pole_sections;
+    for (const complex& q : complex_poles)
+        pole_sections.push_back({-2.0 * q.real(), std::norm(q), std::abs(q)});
+    for (size_t i = 0; i + 1 < real_poles.size(); i += 2)
+    {
+        double p1 = real_poles[i];
+        double p2 = real_poles[i + 1];
+        pole_sections.push_back(
+            {-(p1 + p2), p1 * p2, std::max(std::abs(p1), std::abs(p2))}
+        );
+    }
+    // Sharpest resonances last
+    std::sort(
+        pole_sections.begin(), pole_sections.end(),
+        [](const PoleSection& l, const PoleSection& r)
+        { return l.radius < r.radius; }
+    );
+
+    model.num_sections =
+        std::min(static_cast<int>(pole_sections.size()), numSections);
+    for (int i = 0; i < model.num_sections; ++i)
+    {
+        float* s = model.sections[i];
+        bool single_zero = (i == model.num_sections - 1);
+        s[0] = 1.0f;
+        s[1] = static_cast<float>(single_zero ? -lambda : -2.0 * lambda);
+        s[2] = static_cast<float>(single_zero ? 0.0 : lambda * lambda);
+        s[3] = static_cast<float>(pole_sections[i].a1);
+        s[4] = static_cast<float>(pole_sections[i].a2);
+
+        // Normalise each section to a unit log-average gain so the levels
+        // between sections stay close to the signal level, the overall
+        // level is set below.
+        double log_gain = 0.0;
+        for (int k = 0; k < 256; ++k)
+        {
+            double omega = pi * std::pow(1e-3, 1.0 - k / 255.0);
+            log_gain += std::log(
+                std::abs(sectionResponse(s, std::polar(1.0, -omega)))
+            );
+        }
+        double scale = std::exp(-log_gain / 256.0);
+        for (int c = 0; c < 3; ++c)
+            s[c] = static_cast<float>(s[c] * scale);
+    }
+
+    // Match levels and measure the remaining spectral error
+    const double f_low = 40.0;
+    const double f_high = std::min(12000.0, 0.45 * sampleRate);
+    std::vector<double> centres;
+    for (double f = f_low; f <= f_high; f *= std::pow(2.0, 1.0 / 6.0))
+        centres.push_back(f);
+
+    std::vector<double> target_db = smoothedSpectrumDb(
+        centres, sampleRate, [&x](double w) { return impulsePower(x, w); }
+    );
+    std::vector<double> model_db = smoothedSpectrumDb(
+        centres, sampleRate, [&model](double w) { return modelPower(model, w); }
+    );
+
+    double offset = 0.0;
+    for (size_t i = 0; i < centres.size(); ++i)
+        offset += target_db[i] - model_db[i];
+    offset /= static_cast<double>(centres.size());
+
+    double squared_error = 0.0;
+    for (size_t i = 0; i < centres.size(); ++i)
+    {
+        double e = target_db[i] - model_db[i] - offset;
+        squared_error += e * e;
+    }
+
+    model.gain = static_cast<float>(std::pow(10.0, offset / 20.0));
+    model.error_db = static_cast<float>(
+        std::sqrt(squared_error / static_cast<double>(centres.size()))
+    );
+    return model;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Warped linear prediction fit of an impulse response to a cascade of
+// biquads. The fit runs on a Bark-like warped frequency axis so that the
+// few available poles are spent where a cabinet response actually has
+// detail (low mids), then gets de-warped into a plain biquad cascade.
+//
+// Only depends on the standard library so it can be run outside of the
+// plugin (see scripts/).
+
+struct IIRCascadeModel
+{
+    static constexpr int max_sections = 24;
+
+    int num_sections = 0;
+    // b0, b1, b2, a1, a2 (a0 normalised to 1)
+    float sections[max_sections][5] = {};
+    float gain = 1.0f;
+
+    // RMS difference in dB between the 1/6 octave smoothed magnitude
+    // responses of the model and of the impulse response, over the
+    // fitted band.
+    float error_db = 0.0f;
+};
+
+float warpingFactor(double sampleRate);
+
+IIRCascadeModel fitWarpedLpc(
+    const float* ir, int length, double sampleRate, int numSections
+);
@@ -0,0 +1,88 @@
+#pragma once
+
+// Wright omega function, the solution w of w + log(w) = x, used by the
+// diode models.
+//
+// |x| <= 1.5 uses a 5th order polynomial fit, outside of it the piecewise
+// approximation of omega3 (see omega.h) refined by one Newton step, which
+// is omega4. The template is branchless and evaluates simd::width
+// arguments at once, one float takes the branch to omega4 instead, which
+// scripts/cpp/omega_bench.cpp measures faster than evaluating both sides.
+
+#include "omega.h"
+#include "simd.h"
+
+template <typename F> inline F log2Approx(F x)
+{
+    using I = decltype(simd::asInt(x));
+    I bits = simd::asInt(x);
+    I exponent_bits = bits & I(0x7f800000);
+    F exponent =
+        simd::toFloat(simd::shiftRight<23>(exponent_bits) - I(127));
+    F mantissa = simd::asFloat((bits - exponent_bits) | I(0x3f800000));
+    return exponent - 2.213475204444817f +
+           mantissa * (3.148297929334117f +
+                       mantissa * (-1.098865286222744f +
+                                   mantissa * 0.1640425613334452f));
+}
+
+template <typename F> inline F pow2Approx(F x)
+{
+    using I = decltype(simd::asInt(x));
+    F clamped = simd::max(x, F(-126.0f));
+    F integer = simd::floor(clamped);
+    F f = clamped - integer;
+    I biased = simd::truncateToInt(integer) + I(127);
+    F scale = simd::asFloat(simd::shiftLeft<23>(biased));
+    F result =
+        scale * (1.0f + f * (0.6931471805599453f +
+                             f * (0.2274112777602189f +
+                                  f * 0.07944154167983575f)));
+    return simd::select(x < -126.0f, F(0.0f), result);
+}
+
+template <typename F> inline F omega(F x)
+{
+    // Polynomial fit around the origin
+    const float c0 = 0.5671432904097838f;
+    const float c1 = 0.3618963236098023f;
+    const float c2 = 0.0736778463779836f;
+    const float c3 = -0.0013437346889135f;
+    const float c4 = -0.0016355437889344f;
+    const float c5 = 0.0002166542734346f;
+    F polynomial = c0 + x * (c1 + x * (c2 + x * (c3 + x * (c4 + x * c5))));
+
+    // omega3: 0, cubic, then x - log(x) for large x
+    const float x1 = -3.341459552768620f;
+    const float x2 = 8.0f;
+    const float a = -1.314293149877800e-3f;
+    const float b = 4.775931364975583e-2f;
+    const float c = 3.631952663804445e-1f;
+    const float d = 6.313183464296682e-1f;
+    F cubic = d + x * (c + x * (b + x * a));
+    F asymptote =
+        x - 0.693147180559945f * log2Approx(simd::max(x, F(x2)));
+    F y = simd::select(
+        x < x1, F(0.0f), simd::select(x < x2, cubic, asymptote)
+    );
+
+    // omega4: one Newton step
+    F newton =
+        y - (y - pow2Approx(1.442695040888963f * (x - y))) / (y + 1.0f);
+
+    return simd::select(simd::abs(x) > 1.5f, newton, polynomial);
+}
+
+inline float omega(float x)
+{
+    if (std::abs(x) > 1.5f)
+    {
+        return omega4(x);
+    }
+    return 0.5671432904097838f +
+           x * (0.3618963236098023f +
+                x * (0.0736778463779836f +
+                     x * (-0.0013437346889135f +
+                          x * (-0.0016355437889344f +
+                               x * 0.0002166542734346f))));
+}
@@ -4,67 +4,52 @@
 
 void BorealisOverdrive::prepare(const juce::dsp::ProcessSpec& spec)
 {
-    juce::dsp::ProcessSpec oversampled_spec = spec;
-    oversampled_spec.sampleRate *= 2.0;
-    processSpec = oversampled_spec;
+    // The voicing was tuned with the stages designed at half the rate they
+    // run at: everything past the upsampler is designed at the base rate
+    // and runs at twice it.
+    processSpec = spec;
 
     oversampler2x.reset();
     oversampler2x.initProcessing(static_cast<size_t>(spec.maximumBlockSize));
 
-    attack_shelf.prepare(oversampled_spec);
-    float attack_shelf_gain = charToGain(character);
-    smoothed_attack_shelf_gain = attack_shelf_gain;
-    auto attack_shelf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeHighShelf(
-            oversampled_spec.sampleRate, attack_shelf_freq, 0.5f,
-            attack_shelf_gain
-        );
-    *attack_shelf.coefficients = *attack_shelf_coefficients;
-
-    ff1_lpf.prepare(oversampled_spec);
-    auto ff1_lpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            oversampled_spec.sampleRate, ff1_lpf_cutoff
-        );
-    *ff1_lpf.coefficients = *ff1_lpf_coefficients;
-
-    ff2_hpf.prepare(oversampled_spec);
-    auto ff2_hpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            oversampled_spec.sampleRate, smoothed_ff2_frequency
-        );
-    *ff2_hpf.coefficients = *ff2_hpf_coefficients;
-
-    ff2_lpf.prepare(oversampled_spec);
-    auto ff2_lpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            oversampled_spec.sampleRate, ff2_lpf_cutoff
-        );
-    *ff2_lpf.coefficients = *ff2_lpf_coefficients;
-
-    pre_hpf.prepare(oversampled_spec);
-    auto pre_hpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeHighPass(
-            oversampled_spec.sampleRate, pre_hpf_cutoff
-        );
-    *pre_hpf.coefficients = *pre_hpf_coefficients;
-
-    pre_lpf.prepare(oversampled_spec);
-    auto pre_lpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            oversampled_spec.sampleRate, pre_lpf_cutoff
-        );
-    *pre_lpf.coefficients = *pre_lpf_coefficients;
-
-    post_lpf.prepare(oversampled_spec);
-    auto post_lpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            oversampled_spec.sampleRate, post_lpf_cutoff, post_lpf_q
-        );
-    *post_lpf.coefficients = *post_lpf_coefficients;
+    double sample_rate = spec.sampleRate;
+    attack_shelf_gain = charToGain(character);
+    ff2_hpf_cutoff = driveToFrequency(drive);
+    branches[2].setLane(
+        distortion_lane,
+        rbj::highShelf(sample_rate, attack_shelf_freq, 0.5, attack_shelf_gain)
+    );
+    branches[0].setLane(ff1_lane, rbj::lowPass(sample_rate, ff1_lpf_cutoff));
+    branches[0].setLane(ff2_lane, rbj::lowPass(sample_rate, ff2_hpf_cutoff));
+    branches[1].setLane(ff2_lane, rbj::lowPass(sample_rate, ff2_lpf_cutoff));
+    branches[0].setLane(
+        distortion_lane, rbj::highPass(sample_rate, pre_hpf_cutoff)
+    );
+    branches[1].setLane(
+        distortion_lane, rbj::lowPass(sample_rate, pre_lpf_cutoff)
+    );
+
+    decimator.prepare(
+        spec.sampleRate,
+        static_cast<int>(oversampler2x.getOversamplingFactor()),
+        decimator_taps, decimator_stop_band_db,
+        static_cast<int>(spec.maximumBlockSize)
+    );
+    decimator.setPostFilter(juce::dsp::IIR::Coefficients<float>::makeLowPass(
+        sample_rate, post_lpf_cutoff, post_lpf_q
+    ));
+    reset();
+}
 
-    triode = Triode(oversampled_spec.sampleRate);
-    diode = GermaniumDiode(oversampled_spec.sampleRate);
+void BorealisOverdrive::reset()
+{
+    oversampler2x.reset();
+    decimator.reset();
+    float design_rate = static_cast<float>(processSpec.sampleRate);
+    triode = Triode<Tube12AX7>(design_rate);
+    diode = AntialiasedGermaniumDiode<2>(design_rate);
+    for (auto& layer : branches)
+        layer.reset();
 }
 
 float BorealisOverdrive::driveToFrequency(float d)
@@ -72,7 +57,7 @@ float BorealisOverdrive::driveToFrequency(float d)
     float t = d / 10.0f;
     float min_frequency = 153.0f;
     float max_frequency = 453.0f;
-    return max_frequency - (max_frequency - min_frequency) * std::pow(t, 2.0f);
+    return max_frequency - (max_frequency - min_frequency) * t * t;
 }
 
 float BorealisOverdrive::charToGain(float c)
@@ -80,34 +65,35 @@ float BorealisOverdrive::charToGain(float c)
     float t = c / 10.0f;
     float min_gain = juce::Decibels::decibelsToGain(-12.0f);
     float max_gain = juce::Decibels::decibelsToGain(6.0f);
-    return min_gain + (max_gain - min_gain) * std::pow(t, 3.0f);
+    return min_gain + (max_gain - min_gain) * t * t * t;
 }
 
-void BorealisOverdrive::setCoefficients()
+void BorealisOverdrive::setCoefficients(int numSamples)
 {
-    float attack_shelf_gain = charToGain(character);
-    if (std::abs(smoothed_attack_shelf_gain - attack_shelf_gain) >= 1e-2)
+    // drive and character arrive smoothed, the filters glide to the values
+    // they reach at the end of the block
+    float new_attack_shelf_gain = charToGain(character);
+    if (!juce::approximatelyEqual(attack_shelf_gain, new_attack_shelf_gain))
     {
-        smoothed_attack_shelf_gain +=
-            (attack_shelf_gain - smoothed_attack_shelf_gain) * smoothing_factor;
-        auto attack_shelf_coefficients =
-            juce::dsp::IIR::Coefficients<float>::makeHighShelf(
+        attack_shelf_gain = new_attack_shelf_gain;
+        branches[2].setTarget(
+            distortion_lane,
+            rbj::highShelf(
                 processSpec.sampleRate, attack_shelf_freq, 0.5,
-                smoothed_attack_shelf_gain
-            );
-        *attack_shelf.coefficients = *attack_shelf_coefficients;
+                attack_shelf_gain
+            )
+        );
+        branches[2].glide(numSamples);
     }
 
-    float ff2_frequency = driveToFrequency(drive);
-    if (std::abs(smoothed_ff2_frequency - ff2_frequency) >= 1e-2)
+    float new_ff2_hpf_cutoff = driveToFrequency(drive);
+    if (!juce::approximatelyEqual(ff2_hpf_cutoff, new_ff2_hpf_cutoff))
     {
-        smoothed_ff2_frequency +=
-            (ff2_frequency - smoothed_ff2_frequency) * smoothing_factor;
-        auto ff2_hpf_coefficients =
-            juce::dsp::IIR::Coefficients<float>::makeLowPass(
-                processSpec.sampleRate, smoothed_ff2_frequency
-            );
-        *ff2_hpf.coefficients = *ff2_hpf_coefficients;
+        ff2_hpf_cutoff = new_ff2_hpf_cutoff;
+        branches[0].setTarget(
+            ff2_lane, rbj::lowPass(processSpec.sampleRate, ff2_hpf_cutoff)
+        );
+        branches[0].glide(numSamples);
     }
 }
 
@@ -116,7 +102,7 @@ float BorealisOverdrive::driveToGain(float d)
     float t = d / 10.0f;
     float min_gain = juce::Decibels::decibelsToGain(-6.0f);
     float max_gain = juce::Decibels::decibelsToGain(9.0f);
-    return min_gain + std::pow(t, 2) * (max_gain - min_gain);
+    return min_gain + t * t * (max_gain - min_gain);
 }
 
 void BorealisOverdrive::process(juce::AudioBuffer<float>& buffer)
@@ -125,50 +111,63 @@ void BorealisOverdrive::process(juce::AudioBuffer<float>& buffer)
     {
         return;
     }
-    juce::AudioBuffer<float> dry_buffer;
-    dry_buffer.makeCopyOf(buffer);
+    bool saturate_input = hasInputSaturation();
+    if (processDryOnly(buffer, saturate_input))
+    {
+        return;
+    }
+    const float* dry = copyDry(buffer, saturate_input);
 
-    float sampleRate = static_cast<float>(processSpec.sampleRate);
-    setCoefficients();
+    // Interpolated per oversampled sample across the block
+    setCoefficients(
+        buffer.getNumSamples() *
+        static_cast<int>(oversampler2x.getOversamplingFactor())
+    );
+    drive_gain = driveToGain(drive);
 
     juce::dsp::AudioBlock<float> block(buffer);
     auto oversampledBlock = oversampler2x.processSamplesUp(block);
 
     auto* channelData = oversampledBlock.getChannelPointer(0);
+    if (saturate_input)
+    {
+        input_saturation->applySaturation(
+            channelData, static_cast<int>(oversampledBlock.getNumSamples())
+        );
+    }
     for (size_t i = 0; i < oversampledBlock.getNumSamples(); ++i)
     {
         float sample = channelData[i];
-        applyOverdrive(sample, sampleRate);
+        applyOverdrive(sample, 0.0f);
         channelData[i] = sample;
     }
-    oversampler2x.processSamplesDown(block);
+    decimator.process(
+        channelData, buffer.getWritePointer(0), buffer.getNumSamples()
+    );
 
-    applyGain(buffer, previous_level, level);
-    buffer.applyGain(mix);
-    dry_buffer.applyGain(1.0f - mix);
-    buffer.addFrom(0, 0, dry_buffer, 0, 0, buffer.getNumSamples());
+    mixDry(buffer, dry, 1.0f);
 };
 
 void BorealisOverdrive::applyOverdrive(float& sample, float sampleRate)
 {
     juce::ignoreUnused(sampleRate);
 
-    float drive_gain = driveToGain(drive);
     float in = triode.processSample(sample);
     float in_drive = in * drive_gain;
 
-    // feed forward 1
-    float ff1 = ff1_lpf.processSample(in);
-
-    // feed forward 2
-    float ff2 = ff2_lpf.processSample(ff2_hpf.processSample(in_drive) + in);
-
-    // distortion chain
-    float hpfed = pre_hpf.processSample(in_drive);
-    float lpfed = pre_lpf.processSample(hpfed);
-    float shaped = attack_shelf.processSample(lpfed);
-    float distorded = diode.processSample(shaped);
-    float out = post_lpf.processSample(distorded);
-
-    sample = padding * (out + 0.15f * ff1 + 0.10f * ff2);
+    simd::vfloat4 y = branches[0].processSample(
+        simd::set4(in, in_drive, in_drive, 0.0f)
+    );
+    // feed forward 2 adds the undriven input ahead of its low-pass
+    y = branches[1].processSample(y + simd::set4(0.0f, in, 0.0f, 0.0f));
+    y = branches[2].processSample(y);
+
+    float lanes[ParallelBiquad::num_lanes];
+    simd::store4(lanes, y);
+    float distorded = diode.processSample(lanes[distortion_lane]);
+
+    // The post low-pass is applied by the decimator to the whole sum, the
+    // feed forward paths are already low-passed far below its cutoff.
+    sample = padding * (distorded + 0.15f * lanes[ff1_lane] +
+                        0.10f * lanes[ff2_lane]);
 }
@@ -3,55 +3,73 @@
 #include "../circuits/bjt.h"
 #include "../circuits/germanium_diode.h"
 #include "../circuits/triode.h"
+#include "../filters/parallel_biquad.h"
+#include "../filters/fused_decimator.h"
 #include "overdrive.h"
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
 
-class BorealisOverdrive : public Overdrive
+class BorealisOverdrive final : public Overdrive
 {
   public:
     void prepare(const juce::dsp::ProcessSpec& spec) override;
     void process(juce::AudioBuffer<float>& buffer) override;
-    void setCoefficients();
+    void reset() override;
+    void setCoefficients(int numSamples);
     float charToGain(float);
     float driveToGain(float) override;
     float driveToFrequency(float);
     void applyOverdrive(float& sample, float sampleRate) override;
+    double getTailSeconds() const override
+    {
+        return Tube12AX7::model.tailSeconds();
+    }
 
   private:
-    juce::dsp::IIR::Filter<float> ff1_lpf;
-    float ff1_lpf_cutoff = 106.0f;
-
-    juce::dsp::IIR::Filter<float> ff2_hpf;
-    float smoothed_ff2_frequency = 153.0f;
+    float drive_gain = 1.0f;
 
-    juce::dsp::IIR::Filter<float> ff2_lpf;
-    float ff2_lpf_cutoff = 272.0f;
+    Triode<Tube12AX7> triode;
 
-    juce::dsp::IIR::Filter<float> attack_shelf;
-    float attack_shelf_freq = 500.0f;
-    float smoothed_attack_shelf_gain = 1.0f;
+    // The feed-forward and distortion branches, packed one per lane and
+    // advanced together. Each layer holds the next filter of every
+    // branch, shorter branches pass through:
+    //   lane      0 ff1    1 ff2            2 distortion
+    //   layer 0   ff1_lpf  ff2_hpf (driven) pre_hpf (driven)
+    //   layer 1   -        ff2_lpf (+ in)   pre_lpf
+    //   layer 2   -        -                attack_shelf
+    enum Lane
+    {
+        ff1_lane = 0,
+        ff2_lane = 1,
+        distortion_lane = 2
+    };
+    ParallelBiquad branches[3];
 
-    juce::dsp::IIR::Filter<float> pre_hpf;
+    float ff1_lpf_cutoff = 106.0f;
+    float ff2_hpf_cutoff = 153.0f;
+    float ff2_lpf_cutoff = 272.0f;
     float pre_hpf_cutoff = 129.0f;
-
-    juce::dsp::IIR::Filter<float> pre_lpf;
     float pre_lpf_cutoff = 967.0f;
+    float attack_shelf_freq = 500.0f;
+    float attack_shelf_gain = 1.0f;
 
-    juce::dsp::IIR::Filter<float> post_lpf;
+    // At twice the base rate, the second order antiderivative clips with
+    // less aliasing than the plain diode four times oversampled
+    AntialiasedGermaniumDiode<2> diode;
+
+    // fused into the decimation filter
     float post_lpf_cutoff = 3400.0f;
     float post_lpf_q = 0.57;
+    // Aliases 100 dB down, as low as the clipping is antialiased
+    static constexpr int decimator_taps = 192;
+    static constexpr double decimator_stop_band_db = -120.0;
 
     float padding = juce::Decibels::decibelsToGain(12.0f);
 
-    Triode triode = Triode(44100.0f);
-    GermaniumDiode diode = GermaniumDiode(44100.0f);
-
     juce::dsp::Oversampling<float> oversampler2x{
-        2, 2,
+        2, 1,
         juce::dsp::Oversampling<float>::FilterType::filterHalfBandPolyphaseIIR,
         true, false
     };
-
-    float smoothing_factor = 0.1f;
+    FusedDecimator decimator;
 };
@@ -1,64 +1,257 @@
-#include "Helios.h"
+#include "helios.h"
 #include "../circuits/triode.h"
 
+#include <algorithm>
+#include <cmath>
 #include <juce_dsp/juce_dsp.h>
 
-void HeliosOverdrive::prepare(const juce::dsp::ProcessSpec& spec)
+using OversamplingFilter = juce::dsp::Oversampling<float>::FilterType;
+
+HeliosOverdrive::Core::Core(size_t oversamplingOrder)
+    : oversampler{
+          1, oversamplingOrder, OversamplingFilter::filterHalfBandPolyphaseIIR,
+          true, false
+      }
 {
-    juce::dsp::ProcessSpec oversampled_spec = spec;
-    oversampled_spec.sampleRate *= 2;
-    processSpec = oversampled_spec;
+}
 
-    oversampler2x.reset();
-    oversampler2x.initProcessing(static_cast<size_t>(spec.maximumBlockSize));
+void HeliosOverdrive::Core::prepare(
+    const juce::dsp::ProcessSpec& spec, float postCutoff, float dcCutoff
+)
+{
+    oversampler.reset();
+    oversampler.initProcessing(static_cast<size_t>(spec.maximumBlockSize));
+    design_rate = spec.sampleRate * getFactor() / voicing_ratio;
+    dc_cutoff = dcCutoff;
 
-    dc_hpf.prepare(oversampled_spec);
-    auto dc_hpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeHighPass(
-            oversampled_spec.sampleRate, dc_hpf_cutoff
-        );
-    *dc_hpf.coefficients = *dc_hpf_coefficients;
+    decimator.prepare(
+        spec.sampleRate, getFactor(), decimator_taps_per_factor * getFactor(),
+        decimator_stop_band_db, static_cast<int>(spec.maximumBlockSize)
+    );
+    decimator.setPostFilter(juce::dsp::IIR::Coefficients<float>::makeLowPass(
+        design_rate, postCutoff
+    ));
+    reset();
+}
 
-    dc_hpf2.prepare(oversampled_spec);
-    auto dc_hpf2_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeHighPass(
-            oversampled_spec.sampleRate, dc_hpf2_cutoff
-        );
-    *dc_hpf2.coefficients = *dc_hpf2_coefficients;
+void HeliosOverdrive::Core::reset()
+{
+    oversampler.reset();
+    decimator.reset();
+    pre_filters.reset();
+    float rate = static_cast<float>(design_rate);
+    preamp.get<0>() = Triode<Tube12AX7>(rate);
+    preamp.get<1>().prepare(design_rate, dc_cutoff);
+    preamp.get<3>() = Triode<Tube12AX7>(rate);
+    preamp.get<4>().prepare(design_rate, dc_cutoff);
+    std::fill(delay_line.begin(), delay_line.end(), 0.0f);
+    delay_position = 0;
+    allpass_input = 0.0f;
+    allpass_output = 0.0f;
+}
 
-    pre_hpf.prepare(oversampled_spec);
-    auto pre_hpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeHighPass(
-            oversampled_spec.sampleRate, pre_hpf_cutoff
-        );
-    *pre_hpf.coefficients = *pre_hpf_coefficients;
+void HeliosOverdrive::Core::setDelay(double delaySamples)
+{
+    int whole = std::max(static_cast<int>(std::floor(delaySamples - 0.5)), 0);
+    double fraction = delaySamples - whole;
+    delay_line.assign(static_cast<size_t>(whole), 0.0f);
+    delay_position = 0;
+    allpass_coefficient =
+        static_cast<float>((1.0 - fraction) / (1.0 + fraction));
+    allpass_input = 0.0f;
+    allpass_output = 0.0f;
+}
 
-    mid_scoop.prepare(oversampled_spec);
-    auto mid_scoop_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-            oversampled_spec.sampleRate, mid_scoop_frequency, mid_scoop_q,
-            mid_scoop_gain
+double HeliosOverdrive::Core::measureLatency(int blockSize)
+{
+    reset();
+    // Long enough for the halfband and post filter responses to die out
+    const int length = 512;
+    std::vector<float> block(static_cast<size_t>(blockSize));
+    double moment = 0.0;
+    double sum = 0.0;
+    for (int start = 0; start < length; start += blockSize)
+    {
+        std::fill(block.begin(), block.end(), 0.0f);
+        if (start == 0)
+        {
+            block[0] = 1.0f;
+        }
+        float* channels[] = {block.data()};
+        juce::dsp::AudioBlock<float> audio(
+            channels, 1, static_cast<size_t>(blockSize)
         );
-    *mid_scoop.coefficients = *mid_scoop_coefficients;
-
-    tone_lpf.prepare(oversampled_spec);
-    auto tone_lpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            oversampled_spec.sampleRate, tone_lpf_cutoff
+        auto oversampled = oversampler.processSamplesUp(audio);
+        decimator.process(
+            oversampled.getChannelPointer(0), block.data(), blockSize
         );
-    *tone_lpf.coefficients = *tone_lpf_coefficients;
+        for (int i = 0; i < blockSize; ++i)
+        {
+            moment += static_cast<double>(start + i) * block[(size_t)i];
+            sum += block[(size_t)i];
+        }
+    }
+    reset();
+    return sum != 0.0 ? moment / sum : 0.0;
+}
 
-    post_lpf.prepare(oversampled_spec);
-    auto post_lpf_coefficients =
-        juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            oversampled_spec.sampleRate, post_lpf_cutoff
-        );
-    *post_lpf.coefficients = *post_lpf_coefficients;
+void HeliosOverdrive::Core::delay(float* samples, int numSamples)
+{
+    int length = (int)delay_line.size();
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float sample = samples[i];
+        if (length > 0)
+        {
+            float delayed = delay_line[(size_t)delay_position];
+            delay_line[(size_t)delay_position] = sample;
+            sample = delayed;
+            delay_position = (delay_position + 1) % length;
+        }
+        float output = allpass_coefficient * (sample - allpass_output) +
+                       allpass_input;
+        allpass_input = sample;
+        allpass_output = output;
+        samples[i] = output;
+    }
+}
+
+void HeliosOverdrive::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    base_sample_rate = spec.sampleRate;
+    processSpec = spec;
 
-    triode = Triode(oversampled_spec.sampleRate);
-    triode2 = Triode(oversampled_spec.sampleRate);
-    triode_pre = Triode(oversampled_spec.sampleRate);
-    triode_pre2 = Triode(oversampled_spec.sampleRate);
+    int block_size = static_cast<int>(spec.maximumBlockSize);
+    double latencies[4] = {};
+    double max_latency = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        cores[i].prepare(spec, post_lpf_cutoff, dc_hpf_cutoff);
+        cores[i].pre_filters_oversampled = false;
+        latencies[i] = cores[i].measureLatency(block_size);
+        max_latency = std::max(max_latency, latencies[i]);
+    }
+    // Half a sample more for all, the allpass needs at least that much
+    for (int i = 0; i < 4; ++i)
+        cores[i].setDelay(max_latency + 0.5 - latencies[i]);
+
+    warmup_length = std::max(
+        1, static_cast<int>(std::round(warmup_seconds * spec.sampleRate))
+    );
+    fade_length = std::max(
+        1, static_cast<int>(std::round(fade_seconds * spec.sampleRate))
+    );
+    incoming_core = nullptr;
+    running_core = &selectCore(reduced_oversampling, false);
+    setPreFilterCoefficients(0);
+}
+
+void HeliosOverdrive::reset()
+{
+    for (Core& core : cores)
+        core.reset();
+    incoming_core = nullptr;
+    tone_lpf_cutoff = charToFreq(character);
+    setPreFilterCoefficients(0);
+}
+
+HeliosOverdrive::Core&
+HeliosOverdrive::selectCore(bool reduced, bool preFiltersOversampled)
+{
+    int factor = reduced ? 2 : 4;
+    for (Core* core : {running_core, incoming_core})
+    {
+        if (core != nullptr && core->getFactor() == factor &&
+            core->pre_filters_oversampled == preFiltersOversampled)
+        {
+            return *core;
+        }
+    }
+    Core* other = nullptr;
+    for (Core& core : cores)
+    {
+        if (core.getFactor() == factor && &core != running_core)
+        {
+            other = &core;
+            break;
+        }
+    }
+    return *other;
+}
+
+void HeliosOverdrive::startTransition(Core& core, bool preFiltersOversampled)
+{
+    core.pre_filters_oversampled = preFiltersOversampled;
+    setPreFilterCoefficients(core, 0);
+    core.reset();
+    incoming_core = &core;
+    transition_position = 0;
+}
+
+// Both cores render the same circuit in phase, the fade is linear
+void HeliosOverdrive::crossfadeCores(
+    float* samples, const float* incoming, int numSamples
+)
+{
+    int start = transition_position - warmup_length;
+    transition_position += numSamples;
+    int end = transition_position - warmup_length;
+    if (end <= 0)
+    {
+        return;
+    }
+    float mix_start = static_cast<float>(std::max(start, 0)) / fade_length;
+    float mix_end = std::min(static_cast<float>(end) / fade_length, 1.0f);
+    mixDryWet(
+        samples, samples, incoming, numSamples, mix_start, mix_end, 1.0f,
+        1.0f
+    );
+    if (end >= fade_length)
+    {
+        running_core = incoming_core;
+        incoming_core = nullptr;
+    }
+}
+
+void HeliosOverdrive::setPreFilterCoefficients(int glideSamples)
+{
+    for (Core& core : cores)
+        setPreFilterCoefficients(core, glideSamples);
+}
+
+// glideSamples counts base rate samples
+void HeliosOverdrive::setPreFilterCoefficients(Core& core, int glideSamples)
+{
+    double sampleRate =
+        core.pre_filters_oversampled ? core.design_rate : base_sample_rate;
+
+    core.pre_filters.setTarget(
+        0, rbj::highPass(sampleRate, preFilterCutoff(core, pre_hpf_cutoff))
+    );
+    core.pre_filters.setTarget(
+        1, rbj::lowPass(sampleRate, preFilterCutoff(core, tone_lpf_cutoff))
+    );
+    core.pre_filters.setTarget(
+        2, rbj::peak(
+               sampleRate, preFilterCutoff(core, mid_scoop_frequency),
+               mid_scoop_q, mid_scoop_gain
+           )
+    );
+    core.pre_filters.glide(
+        core.pre_filters_oversampled ? glideSamples * core.getFactor()
+                                     : glideSamples
+    );
+}
+
+float HeliosOverdrive::preFilterCutoff(const Core& core, float cutoff) const
+{
+    if (core.pre_filters_oversampled)
+    {
+        return cutoff;
+    }
+    return juce::jmin(
+        cutoff * voicing_ratio, static_cast<float>(0.45 * base_sample_rate)
+    );
 }
 
 float HeliosOverdrive::driveToGain(float d)
@@ -66,7 +259,7 @@ float HeliosOverdrive::driveToGain(float d)
     float t = d / 10.0f;
     float min_gain = juce::Decibels::decibelsToGain(3.0f);
     float max_gain = juce::Decibels::decibelsToGain(18.0f);
-    return min_gain + std::pow(t, 3.0f) * (max_gain - min_gain);
+    return min_gain + t * t * t * (max_gain - min_gain);
 }
 
 float HeliosOverdrive::charToFreq(float c)
@@ -74,7 +267,7 @@ float HeliosOverdrive::charToFreq(float c)
     float t = character / 10.0f;
     float max_value = 8000.0f;
     float min_value = 800.0f;
-    return min_value + std::pow(t, 2) * (max_value - min_value);
+    return min_value + t * t * (max_value - min_value);
 }
 
 void HeliosOverdrive::process(juce::AudioBuffer<float>& buffer)
@@ -83,53 +276,87 @@ void HeliosOverdrive::process(juce::AudioBuffer<float>& buffer)
     {
         return;
     }
-    juce::AudioBuffer<float> dry_buffer;
-    dry_buffer.makeCopyOf(buffer);
+    bool saturate_input = hasInputSaturation();
+    if (processDryOnly(buffer, saturate_input))
+    {
+        return;
+    }
+    const float* dry = copyDry(buffer, saturate_input);
 
-    // applyGain(buffer, previous_drive_gain, drive_gain);
-    float sampleRate = static_cast<float>(processSpec.sampleRate);
     // Update tone cutoff
     float new_tone_lpf_cutoff = charToFreq(character);
-
     if (!juce::approximatelyEqual(tone_lpf_cutoff, new_tone_lpf_cutoff))
     {
+        // Swept over the samples the filters see in this block
         tone_lpf_cutoff = new_tone_lpf_cutoff;
-        auto tone_lpf_coefficients =
-            juce::dsp::IIR::Coefficients<float>::makeLowPass(
-                sampleRate, tone_lpf_cutoff
-            );
-        *tone_lpf.coefficients = *tone_lpf_coefficients;
+        setPreFilterCoefficients(buffer.getNumSamples());
     }
 
-    juce::dsp::AudioBlock<float> block(buffer);
-    auto oversampledBlock = oversampler2x.processSamplesUp(block);
+    // The saturation has to run ahead of the pre filters, which then move
+    // to the oversampled domain. Either change goes to another core.
+    float* samples = buffer.getWritePointer(0);
+    int numSamples = buffer.getNumSamples();
+    Core& target = selectCore(reduced_oversampling, saturate_input);
+    if (&target == running_core)
+    {
+        incoming_core = nullptr;
+    }
+    else if (&target != incoming_core ||
+             target.pre_filters_oversampled != saturate_input)
+    {
+        startTransition(target, saturate_input);
+    }
 
-    auto* channelData = oversampledBlock.getChannelPointer(0);
-    for (size_t i = 0; i < oversampledBlock.getNumSamples(); ++i)
+    if (incoming_core == nullptr)
     {
-        float sample = channelData[i];
-        applyOverdrive(sample, sampleRate);
-        channelData[i] = sample;
+        processCore(*running_core, samples, numSamples, saturate_input);
+    }
+    else
+    {
+        float* incoming = scratch->get(ScratchPool::transition)[0];
+        std::copy(samples, samples + numSamples, incoming);
+        processCore(*running_core, samples, numSamples, saturate_input);
+        processCore(*incoming_core, incoming, numSamples, saturate_input);
+        crossfadeCores(samples, incoming, numSamples);
     }
-    oversampler2x.processSamplesDown(block);
 
-    applyGain(buffer, previous_level, level);
-    buffer.applyGain(mix);
-    dry_buffer.applyGain(1.0f - mix);
-    buffer.addFrom(0, 0, dry_buffer, 0, 0, buffer.getNumSamples());
+    mixDry(buffer, dry, padding);
 };
 
 void HeliosOverdrive::applyOverdrive(float& sample, float sampleRate)
 {
     juce::ignoreUnused(sampleRate);
+    sample = running_core->preamp.processSample(sample);
+}
 
-    float drive_gain = driveToGain(drive);
-    float hpfed = pre_hpf.processSample(sample);
-    float filtered = mid_scoop.processSample(tone_lpf.processSample(hpfed));
-    float preamped1 =
-        drive_gain * dc_hpf.processSample(triode_pre.processSample(filtered));
-    float preamped2 =
-        dc_hpf2.processSample(triode_pre2.processSample(preamped1));
-    float out = post_lpf.processSample(preamped2);
-    sample = out * padding;
+void HeliosOverdrive::processCore(
+    Core& core, float* samples, int numSamples, bool saturateInput
+)
+{
+    core.preamp.get<2>().setGain(driveToGain(drive));
+    if (!core.pre_filters_oversampled)
+    {
+        core.pre_filters.process(samples, numSamples);
+    }
+
+    float* channels[] = {samples};
+    juce::dsp::AudioBlock<float> block(
+        channels, 1, static_cast<size_t>(numSamples)
+    );
+    auto oversampledBlock = core.oversampler.processSamplesUp(block);
+
+    auto* channelData = oversampledBlock.getChannelPointer(0);
+    int numOversampled = static_cast<int>(oversampledBlock.getNumSamples());
+    // A core fading out may still have its filters at the base rate
+    if (saturateInput)
+    {
+        input_saturation->applySaturation(channelData, numOversampled);
+    }
+    if (core.pre_filters_oversampled)
+    {
+        core.pre_filters.process(channelData, numOversampled);
+    }
+    core.preamp.process(channelData, numOversampled);
+    core.decimator.process(channelData, samples, numSamples);
+    core.delay(samples, numSamples);
 }
@@ -1,51 +1,131 @@
 #pragma once
 
+#include "../circuits/chain.h"
 #include "../circuits/triode.h"
+#include "../filters/biquad.h"
+#include "../filters/fused_decimator.h"
 #include "overdrive.h"
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
+#include <vector>
 
-class HeliosOverdrive : public Overdrive
+class HeliosOverdrive final : public Overdrive
 {
   public:
     void prepare(const juce::dsp::ProcessSpec& spec) override;
     void process(juce::AudioBuffer<float>& buffer) override;
+    void reset() override;
     float driveToGain(float) override;
     float charToFreq(float);
     void applyOverdrive(float& sample, float sampleRate) override;
+    // Both triode stages, in series
+    double getTailSeconds() const override
+    {
+        return 2.0 * Tube12AX7::model.tailSeconds();
+    }
+    void setReducedOversampling(bool shouldReduce) override
+    {
+        reduced_oversampling = shouldReduce;
+    }
 
   private:
-    juce::dsp::IIR::Filter<float> pre_hpf;
+    using Preamp =
+        Chain<Triode<Tube12AX7>, DCBlock, Gain, Triode<Tube12AX7>, DCBlock>;
+
+    // The filters and nonlinear stages at one oversampling factor, designed
+    // at 1 / voicing_ratio of the rate they run at
+    struct Core
+    {
+        explicit Core(size_t oversamplingOrder);
+        void prepare(
+            const juce::dsp::ProcessSpec& spec, float postCutoff,
+            float dcCutoff
+        );
+        // Back to the rest state of the stages
+        void reset();
+        int getFactor() const
+        {
+            return static_cast<int>(oversampler.getOversamplingFactor());
+        }
+        // Group delay at DC of the resampling, in base rate samples, from
+        // its impulse response. Leaves the core at rest.
+        double measureLatency(int blockSize);
+        // Holds the output back by delaySamples, whole samples through a
+        // delay line and the remaining 0.5 to 1.5 through a first order
+        // Thiran allpass, exact at DC
+        void setDelay(double delaySamples);
+        void delay(float* samples, int numSamples);
+
+        juce::dsp::Oversampling<float> oversampler;
+        // high-pass, tone low-pass and mid scoop
+        BiquadCascade<3> pre_filters;
+        Preamp preamp;
+        FusedDecimator decimator;
+        double design_rate = 88200.0;
+        float dc_cutoff = 20.0f;
+        // The pre filters are linear and run at the base rate. They move
+        // to the oversampled domain when a saturation stage runs ahead of
+        // them there.
+        bool pre_filters_oversampled = false;
+        std::vector<float> delay_line;
+        int delay_position = 0;
+        float allpass_coefficient = 0.0f;
+        float allpass_input = 0.0f;
+        float allpass_output = 0.0f;
+    };
+
+    // Immediate when glideSamples is zero
+    void setPreFilterCoefficients(int glideSamples);
+    void setPreFilterCoefficients(Core& core, int glideSamples);
+    float preFilterCutoff(const Core& core, float cutoff) const;
+    // The core for the oversampling factor and the pre filter placement:
+    // the running one or the incoming one when they fit, else one that is
+    // idle at that factor
+    Core& selectCore(bool reduced, bool preFiltersOversampled);
+    void startTransition(Core& core, bool preFiltersOversampled);
+    void crossfadeCores(float* samples, const float* incoming, int numSamples);
+    void processCore(
+        Core& core, float* samples, int numSamples, bool saturateInput
+    );
+
+    // The oversampled stages were voiced at twice the base rate while the
+    // oversampler runs at four times, the base rate filters are designed
+    // with their cutoffs scaled accordingly to keep the same response.
+    static constexpr float voicing_ratio = 2.0f;
+    double base_sample_rate = 44100.0;
+
     float pre_hpf_cutoff = 30.0f;
 
-    juce::dsp::IIR::Filter<float> mid_scoop;
     float mid_scoop_frequency = 600.0f;
     float mid_scoop_q = 0.5f;
     float mid_scoop_gain = juce::Decibels::decibelsToGain(-3.0f);
 
-    juce::dsp::IIR::Filter<float> tone_lpf;
     float tone_lpf_cutoff = 1.0f;
 
-    juce::dsp::IIR::Filter<float> dc_hpf;
     float dc_hpf_cutoff = 20.0f;
 
-    juce::dsp::IIR::Filter<float> dc_hpf2;
-    float dc_hpf2_cutoff = 20.0f;
-
-    juce::dsp::IIR::Filter<float> post_lpf;
+    // fused into the decimation filter
     float post_lpf_cutoff = 3400.0f;
-
-    // triode parameters
+    // The aliases stay below the ones of the half band filters this
+    // replaced, at either factor
+    static constexpr int decimator_taps_per_factor = 32;
+    static constexpr double decimator_stop_band_db = -100.0;
 
     float padding = juce::Decibels::decibelsToGain(-16.0f);
-    Triode triode = Triode(44100);
-    Triode triode2 = Triode(44100);
-    Triode triode_pre = Triode(44100);
-    Triode triode_pre2 = Triode(44100);
-
-    juce::dsp::Oversampling<float> oversampler2x{
-        2, 2,
-        juce::dsp::Oversampling<float>::FilterType::filterHalfBandPolyphaseIIR,
-        true, false
-    };
+
+    // Four times oversampled, and twice when the time runs short, two
+    // cores at each factor, all delayed to the same latency. On a change
+    // of factor or of pre filter placement another core restarts from
+    // rest and runs unheard on the input for warmup_seconds, then the
+    // running core crossfades into it over fade_seconds.
+    Core cores[4] = {Core{2}, Core{2}, Core{1}, Core{1}};
+    Core* running_core = &cores[0];
+    Core* incoming_core = nullptr;
+    bool reduced_oversampling = false;
+
+    static constexpr double warmup_seconds = 0.005;
+    static constexpr double fade_seconds = 0.025;
+    int warmup_length = 1;
+    int fade_length = 1;
+    int transition_position = 0;
 };
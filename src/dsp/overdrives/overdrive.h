@@ -1,4 +1,8 @@
 #pragma once
+#include "../compressor.h"
+#include "../dry_wet.h"
+#include "../scratch_pool.h"
+#include <algorithm>
 #include <juce_dsp/juce_dsp.h>
 
 class Overdrive
@@ -11,27 +15,23 @@ class Overdrive
         return drive;
     };
     virtual void process(juce::AudioBuffer<float>& buffer) {};
+    // Back to the rest state of the circuit, as after prepare()
+    virtual void reset() {};
+    // How long the output rings on once the input stops
+    virtual double getTailSeconds() const
+    {
+        return 0.0;
+    }
+    // Fewer oversampled samples, where the voicing allows, when the time
+    // runs short
+    virtual void setReducedOversampling(bool shouldReduce)
+    {
+        juce::ignoreUnused(shouldReduce);
+    }
     void virtual setCharacter(float newCharacter)
     {
         character = newCharacter;
     }
-
-    void applyGain(
-        juce::AudioBuffer<float>& buffer, float& previous_gain, float& gain
-    )
-    {
-        if (juce::approximatelyEqual(gain, previous_gain))
-        {
-            buffer.applyGain(gain);
-        }
-        else
-        {
-            buffer.applyGainRamp(
-                0, buffer.getNumSamples(), previous_gain, gain
-            );
-            previous_gain = gain;
-        }
-    };
     void setBypass(bool shouldBypass)
     {
         bypass = shouldBypass;
@@ -48,9 +48,83 @@ class Overdrive
     {
         drive = newDrive;
     }
+    // Compressor whose saturation, when deferred, runs at the start of the
+    // oversampled block.
+    void setInputSaturation(const Compressor* compressor)
+    {
+        input_saturation = compressor;
+    }
+    // Holds the dry signal while the wet one is processed in place
+    void setScratchPool(ScratchPool* pool)
+    {
+        scratch = pool;
+    }
 
   protected:
+    // When only the dry signal is heard, with the deferred input
+    // saturation, the wet path does not run. When the mix comes back up
+    // it restarts from rest under the ramp, rather than replay the state
+    // it stopped in.
+    bool processDryOnly(juce::AudioBuffer<float>& buffer, bool saturateInput)
+    {
+        if (previous_mix > 0.0f)
+            return false;
+        if (mix > 0.0f)
+        {
+            reset();
+            return false;
+        }
+        if (saturateInput)
+        {
+            input_saturation->applySaturation(
+                buffer.getWritePointer(0), buffer.getNumSamples()
+            );
+        }
+        previous_level = level;
+        return true;
+    }
+
+    // Copy of the dry signal, with the deferred input saturation, in the
+    // scratch pool. A fully wet block makes none and gets its own samples
+    // back, which mixDry() then weighs by zero.
+    const float* copyDry(juce::AudioBuffer<float>& buffer, bool saturateInput)
+    {
+        float* wet = buffer.getWritePointer(0);
+        if (previous_mix >= 1.0f && mix >= 1.0f)
+            return wet;
+        int numSamples = buffer.getNumSamples();
+        float* dry = scratch->get(ScratchPool::dry)[0];
+        std::copy(wet, wet + numSamples, dry);
+        if (saturateInput)
+            input_saturation->applySaturation(dry, numSamples);
+        return dry;
+    }
+
+    // The wet signal, processed in place, times wetGain and the level,
+    // mixed with the dry one. The level and the mix ramp from the last
+    // block.
+    void mixDry(
+        juce::AudioBuffer<float>& buffer, const float* dry, float wetGain
+    )
+    {
+        float* wet = buffer.getWritePointer(0);
+        mixDryWet(
+            wet, dry, wet, buffer.getNumSamples(), previous_mix, mix,
+            wetGain * previous_level, wetGain * level
+        );
+        previous_mix = mix;
+        previous_level = level;
+    }
+
+    bool hasInputSaturation() const
+    {
+        return input_saturation != nullptr &&
+               input_saturation->hasPendingSaturation();
+    }
+
     juce::dsp::ProcessSpec processSpec{-1, 0, 0};
+    const Compressor* input_saturation = nullptr;
+    ScratchPool* scratch = nullptr;
 
     // gui parameters
     int type;
@@ -63,4 +137,5 @@ class Overdrive
     // state parameters
     float previous_drive_gain = 1.0f;
     float previous_level = 1.0f;
+    float previous_mix = 1.0f;
 };
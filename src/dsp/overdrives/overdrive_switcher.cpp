@@ -0,0 +1,139 @@
+#include "overdrive_switcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+OverdriveSwitcher::OverdriveSwitcher(std::vector<Overdrive*> models)
+    : models(std::move(models))
+{
+    active = this->models.front();
+}
+
+void OverdriveSwitcher::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    fade_length = std::max(
+        1, static_cast<int>(std::round(fade_seconds * spec.sampleRate))
+    );
+    warmup_length = std::max(
+        1, static_cast<int>(std::round(warmup_seconds * spec.sampleRate))
+    );
+
+    int index = std::clamp(selected.load(), 0, (int)models.size() - 1);
+    active = models[static_cast<size_t>(index)];
+    incoming = nullptr;
+    applyParameters(*active);
+}
+
+void OverdriveSwitcher::setParameters(
+    float newLevel, float newDrive, float newCharacter, float newMix
+)
+{
+    level = newLevel;
+    drive = newDrive;
+    character = newCharacter;
+    mix = newMix;
+    applyParameters(*active);
+    if (incoming != nullptr)
+        applyParameters(*incoming);
+}
+
+void OverdriveSwitcher::applyParameters(Overdrive& model) const
+{
+    model.setLevel(level);
+    model.setDrive(drive);
+    model.setCharacter(character);
+    model.setMix(mix);
+}
+
+void OverdriveSwitcher::process(juce::AudioBuffer<float>& buffer)
+{
+    int index = std::clamp(selected.load(), 0, (int)models.size() - 1);
+    Overdrive* model = models[static_cast<size_t>(index)];
+    // A change during the crossfade waits for it to end
+    if (incoming == nullptr && model != active)
+        startSwitch(model);
+
+    float* samples = buffer.getWritePointer(0);
+    int numSamples = buffer.getNumSamples();
+    if (incoming == nullptr)
+    {
+        active->process(buffer);
+        return;
+    }
+
+    float* other = scratch->get(ScratchPool::amp_switch)[0];
+    std::copy(samples, samples + numSamples, other);
+    active->process(buffer);
+    juce::AudioBuffer<float> incoming_buffer(&other, 1, numSamples);
+    incoming->process(incoming_buffer);
+    // Unheard until it has run warmup_length samples
+    if (warmup_remaining > 0)
+    {
+        warmup_remaining -= numSamples;
+        return;
+    }
+    crossfade(samples, other, numSamples);
+}
+
+void OverdriveSwitcher::processSilence(juce::AudioBuffer<float>& buffer)
+{
+    buffer.clear();
+
+    // Silent long enough to have rung out, the models are at rest
+    int index = std::clamp(selected.load(), 0, (int)models.size() - 1);
+    Overdrive* model = models[static_cast<size_t>(index)];
+    if (model != active || incoming != nullptr)
+    {
+        applyParameters(*model);
+        model->reset();
+        active = model;
+        incoming = nullptr;
+    }
+}
+
+double OverdriveSwitcher::getTailSeconds() const
+{
+    if (incoming == nullptr)
+        return active->getTailSeconds();
+    return std::max(active->getTailSeconds(), incoming->getTailSeconds());
+}
+
+void OverdriveSwitcher::startSwitch(Overdrive* model)
+{
+    incoming = model;
+    fade_position = 0;
+    applyParameters(*model);
+    model->reset();
+    warmup_remaining = warmup_length;
+}
+
+// cos and sin of the fade position over a quarter turn, the sum of the
+// powers stays constant for the uncorrelated outputs of two models. Both
+// are interpolated across the block.
+void OverdriveSwitcher::crossfade(
+    float* samples, const float* other, int numSamples
+)
+{
+    const float quarter_turn = juce::MathConstants<float>::halfPi;
+    float start = static_cast<float>(fade_position) / fade_length;
+    fade_position = std::min(fade_position + numSamples, fade_length);
+    float end = static_cast<float>(fade_position) / fade_length;
+
+    float out_gain = std::cos(start * quarter_turn);
+    float in_gain = std::sin(start * quarter_turn);
+    float step = 1.0f / static_cast<float>(std::max(numSamples, 1));
+    float out_step = (std::cos(end * quarter_turn) - out_gain) * step;
+    float in_step = (std::sin(end * quarter_turn) - in_gain) * step;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        out_gain += out_step;
+        in_gain += in_step;
+        samples[i] = samples[i] * out_gain + other[i] * in_gain;
+    }
+
+    if (fade_position == fade_length)
+    {
+        active = incoming;
+        incoming = nullptr;
+    }
+}
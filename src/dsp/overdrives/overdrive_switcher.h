@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../scratch_pool.h"
+#include "overdrive.h"
+#include <atomic>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <vector>
+
+// Runs the selected amp model, and only that one: the others cost nothing
+// and get the parameters when they are selected. On a change the incoming
+// model restarts from rest and runs unheard on the input for
+// warmup_seconds, so that its coupling capacitors and filters sit where the
+// signal put them, then both run through an equal power crossfade of
+// fade_seconds.
+class OverdriveSwitcher
+{
+  public:
+    explicit OverdriveSwitcher(std::vector<Overdrive*> models);
+
+    // At once, without a crossfade
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void setScratchPool(ScratchPool* pool)
+    {
+        scratch = pool;
+    }
+
+    // From any thread, the switch starts with the next block
+    void select(int index)
+    {
+        selected = index;
+    }
+    void setParameters(float level, float drive, float character, float mix);
+
+    void process(juce::AudioBuffer<float>& buffer);
+    // While the amp sleeps, a pending switch completes at once
+    void processSilence(juce::AudioBuffer<float>& buffer);
+    double getTailSeconds() const;
+
+  private:
+    void startSwitch(Overdrive* model);
+    void applyParameters(Overdrive& model) const;
+    void crossfade(float* samples, const float* other, int numSamples);
+
+    static constexpr double warmup_seconds = 0.005;
+    static constexpr double fade_seconds = 0.03;
+
+    std::vector<Overdrive*> models;
+    std::atomic<int> selected{0};
+    Overdrive* active = nullptr;
+    Overdrive* incoming = nullptr;
+    ScratchPool* scratch = nullptr;
+
+    int fade_length = 1;
+    int fade_position = 0;
+    int warmup_length = 1;
+    int warmup_remaining = 0;
+
+    float level = 1.0f;
+    float drive = 0.0f;
+    float character = 0.0f;
+    float mix = 1.0f;
+};
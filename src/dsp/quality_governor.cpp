@@ -0,0 +1,99 @@
+#include "quality_governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+void QualityGovernor::prepare(double sampleRate)
+{
+    sample_rate = sampleRate;
+    level = full;
+    recovered = 0.0;
+    settling = false;
+    clearWindow();
+}
+
+void QualityGovernor::setEnabled(bool shouldAdapt)
+{
+    if (shouldAdapt == enabled)
+        return;
+    enabled = shouldAdapt;
+    prepare(sample_rate);
+}
+
+void QualityGovernor::beginBlock()
+{
+    block_start = std::chrono::steady_clock::now();
+}
+
+void QualityGovernor::endBlock(int numSamples)
+{
+    if (!enabled || numSamples <= 0)
+        return;
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - block_start;
+    double deadline = numSamples / sample_rate;
+    int bin = static_cast<int>(elapsed.count() / deadline * bins_per_deadline);
+    ++histogram[std::clamp(bin, 0, num_bins - 1)];
+
+    window_elapsed += deadline;
+    if (window_elapsed >= window_seconds)
+        decide();
+}
+
+void QualityGovernor::decide()
+{
+    if (settling)
+    {
+        settling = false;
+        clearWindow();
+        return;
+    }
+
+    // The budget and the headroom are rounded to the bins
+    int first_over = static_cast<int>(std::ceil(budget * bins_per_deadline));
+    int total = 0;
+    int over_budget = 0;
+    for (int bin = 0; bin < num_bins; ++bin)
+    {
+        total += histogram[bin];
+        if (bin >= first_over)
+            over_budget += histogram[bin];
+    }
+    // Stray slow blocks, the scheduler's rather than ours, neither step
+    // down nor hold the recovery back
+    int typical = 0;
+    for (int count = histogram[0]; count < typical_share * total;)
+        count += histogram[++typical];
+
+    if (over_budget > max_over_budget && typical >= first_over)
+    {
+        recovered = 0.0;
+        if (level < lowest)
+        {
+            level = static_cast<Level>(level + 1);
+            settling = true;
+        }
+    }
+    else if (typical + 1 <= budget * headroom * bins_per_deadline)
+    {
+        recovered += window_elapsed;
+        if (recovered >= recovery_seconds && level > full)
+        {
+            level = static_cast<Level>(level - 1);
+            recovered = 0.0;
+            settling = true;
+        }
+    }
+    else
+    {
+        recovered = 0.0;
+    }
+    clearWindow();
+}
+
+void QualityGovernor::clearWindow()
+{
+    std::fill(histogram, histogram + num_bins, 0);
+    window_elapsed = 0.0;
+}
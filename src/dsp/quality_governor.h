@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+
+// Times every block against its deadline, the duration of the buffer, and
+// picks the quality the chain runs at. Once per window of audio, the level
+// steps down when more than max_over_budget blocks, and more than
+// 1 - typical_share of them, took more than the budget share of their
+// deadline. It steps back up once typical_share of the blocks have stayed
+// under headroom times the budget for recovery_seconds. Each level keeps
+// the savings of the ones before it.
+class QualityGovernor
+{
+  public:
+    enum Level
+    {
+        full = 0,
+        reduced_oversampling, // the four times oversampled amp at twice
+        coarse_compressor,    // the compressor gain at a coarser rate
+        eco_cabinet,          // the IR approximated by its biquad cascade
+        lowest = eco_cabinet
+    };
+
+    // Histogram of the block loads, processing time over deadline, in bins
+    // of 1 / bins_per_deadline. The last bin holds the missed deadlines.
+    static constexpr int bins_per_deadline = 20;
+    static constexpr int num_bins = bins_per_deadline + 1;
+
+    void prepare(double sampleRate);
+    // Back to full quality when disabled
+    void setEnabled(bool shouldAdapt);
+    void setBudget(float shareOfDeadline)
+    {
+        budget = shareOfDeadline;
+    }
+
+    void beginBlock();
+    void endBlock(int numSamples);
+
+    Level getLevel() const
+    {
+        return level;
+    }
+
+  private:
+    void decide();
+    void clearWindow();
+
+    static constexpr double window_seconds = 0.25;
+    static constexpr int max_over_budget = 2;
+    static constexpr double recovery_seconds = 5.0;
+    static constexpr float headroom = 0.5f;
+    static constexpr float typical_share = 0.95f;
+
+    bool enabled = true;
+    float budget = 0.7f;
+    Level level = full;
+    double sample_rate = 44100.0;
+
+    std::chrono::steady_clock::time_point block_start;
+    int histogram[num_bins] = {};
+    double window_elapsed = 0.0;
+    double recovered = 0.0;
+    // The window after a change also times its crossfades, it is not used
+    bool settling = false;
+};
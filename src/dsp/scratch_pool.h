@@ -0,0 +1,38 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+// Working buffers owned by the chain, allocated in prepare() and lent to
+// the stages. The stages run one after the other and what one writes to a
+// scratch buffer only lasts until it returns, so they all share the pool.
+// A stage running inside another one takes a slot of its own.
+class ScratchPool
+{
+  public:
+    enum Slot
+    {
+        dry = 0,    // the dry copy of a stage, or its wet output
+        transition, // the incoming state of a stage that changes inside
+        amp_switch, // the incoming amp model, around the two above
+        num_buffers
+    };
+
+    void prepare(int numChannels, int maximumBlockSize)
+    {
+        for (auto& buffer : buffers)
+            buffer.setSize(numChannels, maximumBlockSize);
+    }
+
+    int getNumChannels() const
+    {
+        return buffers[0].getNumChannels();
+    }
+    // The channels of a buffer, maximumBlockSize samples each
+    float* const* get(Slot slot)
+    {
+        return buffers[slot].getArrayOfWritePointers();
+    }
+
+  private:
+    juce::AudioBuffer<float> buffers[num_buffers];
+};
@@ -0,0 +1,82 @@
+#include "smoother_bank.h"
+#include "maths/simd.h"
+
+#include <algorithm>
+
+int SmootherBank::add(float initialValue, float rampSeconds)
+{
+    int index = size++;
+    ramp_seconds[index] = rampSeconds;
+    setCurrentAndTarget(index, initialValue);
+    return index;
+}
+
+void SmootherBank::prepare(double sampleRate)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        ramp_samples[i] = std::max(
+            1.0f, static_cast<float>(ramp_seconds[i] * sampleRate)
+        );
+        setCurrentAndTarget(i, target[i]);
+    }
+}
+
+void SmootherBank::setCurrentAndTarget(int index, float newValue)
+{
+    target[index] = newValue;
+    aimed[index] = newValue;
+    value[index] = newValue;
+    start[index] = newValue;
+    step[index] = 0.0f;
+    remaining[index] = 0.0f;
+}
+
+void SmootherBank::advance(int numSamples)
+{
+    using simd::vfloat;
+    const vfloat block(static_cast<float>(numSamples));
+    for (int i = 0; i < size; i += simd::width)
+    {
+        vfloat t = simd::load(target + i);
+        vfloat v = simd::load(value + i);
+        vfloat s = simd::load(step + i);
+        vfloat r = simd::load(remaining + i);
+        simd::store(start + i, v);
+
+        // A moved target restarts a full ramp from the current value
+        vfloat n = simd::load(ramp_samples + i);
+        simd::vmask moved = simd::abs(t - simd::load(aimed + i)) > vfloat(0.0f);
+        s = simd::select(moved, (t - v) / n, s);
+        r = simd::select(moved, n, r);
+
+        vfloat k = simd::min(r, block);
+        v = v + s * k;
+        r = r - k;
+        // Lands exactly on the target
+        v = simd::select(r < vfloat(0.5f), t, v);
+
+        simd::store(aimed + i, t);
+        simd::store(value + i, v);
+        simd::store(step + i, s);
+        simd::store(remaining + i, r);
+    }
+}
+
+void SmootherBank::applyRamp(int index, float* samples, int numSamples) const
+{
+    float gain = start[index];
+    if (gain == value[index])
+    {
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] *= gain;
+        return;
+    }
+    float increment =
+        (value[index] - gain) / static_cast<float>(std::max(numSamples, 1));
+    for (int i = 0; i < numSamples; ++i)
+    {
+        samples[i] *= gain;
+        gain += increment;
+    }
+}
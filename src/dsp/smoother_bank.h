@@ -0,0 +1,63 @@
+#pragma once
+
+// Linear ramps for all the continuous parameters, stored as structure of
+// arrays and advanced together once per block.
+//
+// The targets are plain floats written by the parameter listeners and
+// picked up at the next advance(), which restarts the ramp of any target
+// that moved. After advance(numSamples) every smoother exposes the value at
+// the start and at the end of the block: stages either take the end value
+// as a control value for the block, or ramp between both per sample with
+// applyRamp(), as juce::AudioBuffer::applyGainRamp does.
+class SmootherBank
+{
+  public:
+    static constexpr int capacity = 32;
+
+    // Registers a smoother and returns its index, before prepare()
+    int add(float initialValue, float rampSeconds);
+    void prepare(double sampleRate);
+
+    void setTarget(int index, float newTarget)
+    {
+        target[index] = newTarget;
+    }
+    // Jumps to the value, without ramp
+    void setCurrentAndTarget(int index, float newValue);
+
+    void advance(int numSamples);
+
+    float getStart(int index) const
+    {
+        return start[index];
+    }
+    float getEnd(int index) const
+    {
+        return value[index];
+    }
+    bool isSmoothing(int index) const
+    {
+        return start[index] != value[index];
+    }
+    // Value at a fraction of the block, for sub-block control rates
+    float getValueAt(int index, float fraction) const
+    {
+        return start[index] + (value[index] - start[index]) * fraction;
+    }
+
+    // Multiplies by the gain ramp of the smoother over the block
+    void applyRamp(int index, float* samples, int numSamples) const;
+
+  private:
+    int size = 0;
+    float ramp_seconds[capacity] = {};
+
+    // Padded to a whole number of SIMD registers
+    alignas(32) float target[capacity] = {};
+    alignas(32) float aimed[capacity] = {};
+    alignas(32) float value[capacity] = {};
+    alignas(32) float start[capacity] = {};
+    alignas(32) float step[capacity] = {};
+    alignas(32) float remaining[capacity] = {};
+    alignas(32) float ramp_samples[capacity] = {};
+};
@@ -7,9 +7,10 @@
 
 Header::Header(
     juce::AudioProcessorValueTreeState& params, juce::Value& vin,
-    juce::Value& vout
+    juce::Value& vout, juce::Value& quality
 )
-    : parameters(params), inputMeter(vin), outputMeter(vout)
+    : parameters(params), inputMeter(vin), outputMeter(vout),
+      qualityValue(quality)
 {
     setLookAndFeel(new HeaderLookAndFeel());
 
@@ -26,6 +27,10 @@ Header::Header(
     outputLabel.setText("OUT", juce::dontSendNotification);
     outputLabel.setJustificationType(juce::Justification::right);
 
+    addAndMakeVisible(qualityLabel);
+    qualityLabel.setJustificationType(juce::Justification::centred);
+    qualityValue.addListener(this);
+
     addAndMakeVisible(inputGainSlider);
     inputGainSlider.setSkewFactor(3.0);
     inputGainSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
@@ -53,6 +58,18 @@ Header::Header(
 
 Header::~Header()
 {
+    qualityValue.removeListener(this);
+}
+
+void Header::valueChanged(juce::Value& v)
+{
+    // What the adaptive quality gave up, in the order it gives it up, see
+    // QualityGovernor::Level
+    static const char* const reductions[] = {
+        "", "AMP 2X", "AMP 2X, COARSE COMP", "AMP 2X, COARSE COMP, ECO IR"
+    };
+    int level = juce::jlimit(0, 3, static_cast<int>(v.getValue()));
+    qualityLabel.setText(reductions[level], juce::dontSendNotification);
 }
 
 void Header::paint(juce::Graphics& g)
@@ -78,8 +95,8 @@ void Header::resized()
     );
     auto label_bounds =
         bounds.withTrimmedLeft(label_padding).withTrimmedRight(label_padding);
-    inputLabel.setBounds(
-        label_bounds.removeFromLeft(label_bounds.getWidth() / 2)
-    );
-    outputLabel.setBounds(label_bounds);
+    int const label_width = label_bounds.getWidth() / 3;
+    inputLabel.setBounds(label_bounds.removeFromLeft(label_width));
+    outputLabel.setBounds(label_bounds.removeFromRight(label_width));
+    qualityLabel.setBounds(label_bounds);
 }
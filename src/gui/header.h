@@ -5,14 +5,18 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_gui_basics/juce_gui_basics.h>
 
-class Header : public juce::Component
+class Header : public juce::Component, public juce::Value::Listener
 {
   public:
-    Header(juce::AudioProcessorValueTreeState&, juce::Value&, juce::Value&);
+    Header(
+        juce::AudioProcessorValueTreeState&, juce::Value&, juce::Value&,
+        juce::Value&
+    );
     ~Header() override;
 
     void resized() override;
     void paint(juce::Graphics&) override;
+    void valueChanged(juce::Value& v) override;
 
   private:
     juce::AudioProcessorValueTreeState& parameters;
@@ -22,6 +26,8 @@ class Header : public juce::Component
     juce::Colour headerColour = ColourCodes::white0;
     juce::Label inputLabel;
     juce::Label outputLabel;
+    juce::Value qualityValue;
+    juce::Label qualityLabel;
 
     juce::Slider inputGainSlider;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>
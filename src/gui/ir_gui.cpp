@@ -5,8 +5,10 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
 
-IRLoader::IRLoader(juce::AudioProcessorValueTreeState& params)
-    : parameters(params)
+IRLoader::IRLoader(
+    juce::AudioProcessorValueTreeState& params, juce::Value& modelError
+)
+    : parameters(params), modelErrorValue(modelError)
 {
     // Set up the "Load File" button
     addAndMakeVisible(loadButton);
@@ -28,6 +30,18 @@ IRLoader::IRLoader(juce::AudioProcessorValueTreeState& params)
             parameters, "ir_bypass", bypassButton
         );
 
+    addAndMakeVisible(ecoLabel);
+    ecoLabel.setText("ECO", juce::dontSendNotification);
+    ecoLabel.setJustificationType(juce::Justification::right);
+
+    addAndMakeVisible(ecoButton);
+    ecoButton.setButtonText("ECO");
+    ecoButtonAttachment =
+        std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+            parameters, "ir_eco", ecoButton
+        );
+    modelErrorValue.addListener(this);
+
     addAndMakeVisible(statusLabel);
     statusLabel.setJustificationType(juce::Justification::centred);
 
@@ -80,6 +94,24 @@ IRLoader::IRLoader(juce::AudioProcessorValueTreeState& params)
 
 IRLoader::~IRLoader()
 {
+    modelErrorValue.removeListener(this);
+}
+
+void IRLoader::valueChanged(juce::Value& v)
+{
+    // Show how far the eco approximation strays from the loaded IR
+    float error_db = static_cast<float>(v.getValue());
+    if (error_db < 0.0f)
+    {
+        ecoLabel.setText("ECO", juce::dontSendNotification);
+    }
+    else
+    {
+        ecoLabel.setText(
+            "ECO (" + juce::String(error_db, 1) + " dB ERROR)",
+            juce::dontSendNotification
+        );
+    }
 }
 
 void IRLoader::paint(juce::Graphics& g)
@@ -108,6 +140,10 @@ void IRLoader::resized()
                               .withTrimmedLeft(label_padding));
     bypassLabel.setBounds(bottom_bounds.withTrimmedRight(label_padding));
 
+    auto eco_bounds = bounds.removeFromBottom(button_size);
+    ecoButton.setBounds(eco_bounds.removeFromRight(button_size));
+    ecoLabel.setBounds(eco_bounds.withTrimmedRight(label_padding));
+
     const int knob_size = bounds.getWidth() / 3;
     bounds.removeFromLeft(knob_size / 2);
     bounds.removeFromRight(knob_size / 2);
@@ -3,13 +3,14 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_gui_basics/juce_gui_basics.h>
 
-class IRLoader : public juce::Component
+class IRLoader : public juce::Component, public juce::Value::Listener
 {
   public:
-    IRLoader(juce::AudioProcessorValueTreeState&);
+    IRLoader(juce::AudioProcessorValueTreeState&, juce::Value&);
     ~IRLoader() override;
     void paint(juce::Graphics& g) override;
     void resized() override;
+    void valueChanged(juce::Value& v) override;
     void refreshStatus();
     void switchColour();
 
@@ -23,6 +24,11 @@ class IRLoader : public juce::Component
     juce::Label bypassLabel;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment>
         bypassButtonAttachment;
+    juce::ToggleButton ecoButton;
+    juce::Label ecoLabel;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment>
+        ecoButtonAttachment;
+    juce::Value modelErrorValue;
     juce::TextButton loadButton;
     juce::Label statusLabel;
     std::unique_ptr<juce::FileChooser> chooser;
@@ -9,7 +9,7 @@
 
 Tabs::Tabs(
     juce::AudioProcessorValueTreeState& params,
-    juce::Value& compressorGainReductionDb
+    juce::Value& compressorGainReductionDb, juce::Value& irModelErrorDb
 )
     : juce::TabbedComponent(juce::TabbedButtonBar::TabsAtTop),
       parameters(params),
@@ -27,7 +27,7 @@ Tabs::Tabs(
     addTab("COMP", ColourCodes::bg, &compressor_component, false);
     addTab("AMP", ColourCodes::bg, &amp_component, true);
     // addTab("CHORUS", AuroraColors::bg, new juce::Component(), true);
-    addTab("IR", ColourCodes::bg, new IRLoader(params), true);
+    addTab("IR", ColourCodes::bg, new IRLoader(params, irModelErrorDb), true);
     setTabBarDepth(60);
 }
 
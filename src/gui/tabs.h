@@ -9,7 +9,7 @@
 class Tabs : public juce::TabbedComponent
 {
   public:
-    Tabs(juce::AudioProcessorValueTreeState&, juce::Value&);
+    Tabs(juce::AudioProcessorValueTreeState&, juce::Value&, juce::Value&);
     ~Tabs() override;
     void paint(juce::Graphics&) override;
 
@@ -37,6 +37,21 @@ juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
             "compressor_mix", "Compressor Mix",
             juce::NormalisableRange<float>(0, 100, 1, 1.0f), 50
         ),
+        std::make_unique<juce::AudioParameterBool>(
+            "compressor_oversampled", "Compressor Oversampled Saturation", false
+        ),
+        std::make_unique<juce::AudioParameterBool>(
+            "compressor_multiband", "Compressor Multiband", false
+        ),
+        std::make_unique<juce::AudioParameterFloat>(
+            "compressor_low_crossover", "Compressor Low Crossover",
+            juce::NormalisableRange<float>(60.0f, 500.0f, 1.0f, 0.5f), 200.0f
+        ),
+        std::make_unique<juce::AudioParameterFloat>(
+            "compressor_high_crossover", "Compressor High Crossover",
+            juce::NormalisableRange<float>(1000.0f, 8000.0f, 1.0f, 0.5f),
+            2500.0f
+        ),
         std::make_unique<juce::AudioParameterChoice>(
             "amp_type",                              // Parameter ID
             "Amp Type",                              // Display name
@@ -89,9 +104,22 @@ juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
             "ir_mix", "Impulse Response Mix",
             juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.5f
         ),
+        std::make_unique<juce::AudioParameterBool>(
+            "ir_eco", "Impulse Response Eco Mode", false
+        ),
+        std::make_unique<juce::AudioParameterBool>(
+            "ir_fold_eq", "Fold Amp EQ Into Impulse Response", false
+        ),
         std::make_unique<juce::AudioParameterFloat>(
             "ir_gain_db", "Impulse Response Gain dB",
             juce::NormalisableRange<float>(-12.0f, 12.0f, 0.01f, 1.0f), 0.0f
+        ),
+        std::make_unique<juce::AudioParameterBool>(
+            "quality_adaptive", "Adaptive Quality", true
+        ),
+        std::make_unique<juce::AudioParameterFloat>(
+            "quality_budget", "Adaptive Quality Budget %",
+            juce::NormalisableRange<float>(25.0f, 100.0f, 1.0f), 70.0f
         )
     };
 }
@@ -18,11 +18,31 @@ PluginAudioProcessor::PluginAudioProcessor()
 {
     parameters.state.setProperty("ir_filepath", juce::String(""), nullptr);
 
-    inputGainParameter = parameters.getRawParameterValue("input_gain_db");
-    outputGainParameter = parameters.getRawParameterValue("output_gain_db");
-    ampMasterGainParameter = parameters.getRawParameterValue("amp_master");
     isAmpBypassed = false;
 
+    // The values are set in prepareToPlay
+    auto addSmoother = [this]()
+    { return smoothers.add(0.0f, smoothing_seconds); };
+    smoothed.input_gain = addSmoother();
+    smoothed.output_gain = addSmoother();
+    smoothed.amp_master = addSmoother();
+    smoothed.compressor_threshold = addSmoother();
+    smoothed.compressor_ratio = addSmoother();
+    smoothed.compressor_level = addSmoother();
+    smoothed.compressor_mix = addSmoother();
+    smoothed.compressor_low_crossover = addSmoother();
+    smoothed.compressor_high_crossover = addSmoother();
+    smoothed.overdrive_level = addSmoother();
+    smoothed.overdrive_drive = addSmoother();
+    smoothed.overdrive_character = addSmoother();
+    smoothed.overdrive_mix = addSmoother();
+    smoothed.eq_bass = addSmoother();
+    smoothed.eq_low_mid = addSmoother();
+    smoothed.eq_high_mid = addSmoother();
+    smoothed.eq_treble = addSmoother();
+    smoothed.ir_mix = addSmoother();
+    smoothed.ir_gain = addSmoother();
+
     parameters.addParameterListener("input_gain_db", this);
     parameters.addParameterListener("output_gain_db", this);
     parameters.addParameterListener("compressor_bypass", this);
@@ -31,6 +51,10 @@ PluginAudioProcessor::PluginAudioProcessor()
     parameters.addParameterListener("compressor_level_db", this);
     parameters.addParameterListener("compressor_type", this);
     parameters.addParameterListener("compressor_mix", this);
+    parameters.addParameterListener("compressor_oversampled", this);
+    parameters.addParameterListener("compressor_multiband", this);
+    parameters.addParameterListener("compressor_low_crossover", this);
+    parameters.addParameterListener("compressor_high_crossover", this);
     parameters.addParameterListener("amp_type", this);
     parameters.addParameterListener("amp_bypass", this);
     parameters.addParameterListener("amp_master", this);
@@ -46,6 +70,10 @@ PluginAudioProcessor::PluginAudioProcessor()
     parameters.addParameterListener("ir_mix", this);
     parameters.addParameterListener("ir_filepath", this);
     parameters.addParameterListener("ir_gain_db", this);
+    parameters.addParameterListener("ir_eco", this);
+    parameters.addParameterListener("ir_fold_eq", this);
+    parameters.addParameterListener("quality_adaptive", this);
+    parameters.addParameterListener("quality_budget", this);
 }
 
 PluginAudioProcessor::~PluginAudioProcessor()
@@ -79,7 +107,13 @@ bool PluginAudioProcessor::isMidiEffect() const
 
 double PluginAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The compressor output stops with its input, the amp, its EQ and the
+    // cabinet ring on in series
+    double overdrive_tail = juce::jmax(
+        helios_overdrive.getTailSeconds(), borealis_overdrive.getTailSeconds()
+    );
+    return overdrive_tail + amp_eq.getTailSeconds() +
+           irConvolver.getTailSeconds();
 }
 
 int PluginAudioProcessor::getNumPrograms()
@@ -116,7 +150,19 @@ void PluginAudioProcessor::parameterChanged(
     const juce::String& parameterID, float newValue
 )
 {
-    if (parameterID == "compressor_bypass")
+    if (parameterID == "input_gain_db")
+    {
+        smoothers.setTarget(
+            smoothed.input_gain, juce::Decibels::decibelsToGain(newValue)
+        );
+    }
+    else if (parameterID == "output_gain_db")
+    {
+        smoothers.setTarget(
+            smoothed.output_gain, juce::Decibels::decibelsToGain(newValue)
+        );
+    }
+    else if (parameterID == "compressor_bypass")
     {
         compressor.setBypass(newValue >= 0.5f);
     }
@@ -124,15 +170,20 @@ void PluginAudioProcessor::parameterChanged(
     {
         const float values[] = {2.0f, 4.0f, 8.0f, 12.0f, 20.0f};
         int index = static_cast<int>(newValue);
-        compressor.setRatio(values[index]);
+        smoothers.setTarget(smoothed.compressor_ratio, values[index]);
     }
     else if (parameterID == "compressor_threshold")
     {
-        compressor.setThreshold(juce::Decibels::decibelsToGain(newValue));
+        smoothers.setTarget(
+            smoothed.compressor_threshold,
+            juce::Decibels::decibelsToGain(newValue)
+        );
     }
     else if (parameterID == "compressor_level_db")
     {
-        compressor.setLevel(juce::Decibels::decibelsToGain(newValue));
+        smoothers.setTarget(
+            smoothed.compressor_level, juce::Decibels::decibelsToGain(newValue)
+        );
     }
     else if (parameterID == "compressor_type")
     {
@@ -140,13 +191,30 @@ void PluginAudioProcessor::parameterChanged(
     }
     else if (parameterID == "compressor_mix")
     {
-        compressor.setMix(static_cast<int>(newValue) / 100.0f);
+        smoothers.setTarget(
+            smoothed.compressor_mix, static_cast<int>(newValue) / 100.0f
+        );
+    }
+    else if (parameterID == "compressor_oversampled")
+    {
+        isCompressorOversampled = (newValue >= 0.5f);
+    }
+    else if (parameterID == "compressor_multiband")
+    {
+        compressor.setMultiband(newValue >= 0.5f);
+    }
+    else if (parameterID == "compressor_low_crossover")
+    {
+        smoothers.setTarget(smoothed.compressor_low_crossover, newValue);
+    }
+    else if (parameterID == "compressor_high_crossover")
+    {
+        smoothers.setTarget(smoothed.compressor_high_crossover, newValue);
     }
     // Amp type
     if (parameterID == "amp_type")
     {
-        int index = static_cast<int>(newValue);
-        current_overdrive = overdrives[index];
+        overdrive_switcher.select(static_cast<int>(newValue));
     }
     // Overdrive
     if (parameterID == "amp_bypass")
@@ -158,50 +226,61 @@ void PluginAudioProcessor::parameterChanged(
             overdrive->setBypass(newValue >= 0.5f);
         }
     }
+    else if (parameterID == "amp_master")
+    {
+        smoothers.setTarget(
+            smoothed.amp_master, juce::Decibels::decibelsToGain(newValue)
+        );
+    }
     else if (parameterID == "overdrive_mix")
     {
-        for (auto& overdrive : overdrives)
-        {
-            overdrive->setMix(static_cast<int>(newValue) / 100.0f);
-        }
+        smoothers.setTarget(
+            smoothed.overdrive_mix, static_cast<int>(newValue) / 100.0f
+        );
     }
     else if (parameterID == "overdrive_level_db")
     {
-        for (auto& overdrive : overdrives)
-        {
-            overdrive->setLevel(juce::Decibels::decibelsToGain(newValue));
-        }
+        smoothers.setTarget(
+            smoothed.overdrive_level, juce::Decibels::decibelsToGain(newValue)
+        );
     }
     else if (parameterID == "overdrive_drive")
     {
-        for (auto& overdrive : overdrives)
-        {
-            overdrive->setDrive(newValue);
-        }
+        smoothers.setTarget(smoothed.overdrive_drive, newValue);
     }
     else if (parameterID == "overdrive_character")
     {
-        for (auto& overdrive : overdrives)
-        {
-            overdrive->setCharacter(newValue);
-        }
+        smoothers.setTarget(smoothed.overdrive_character, newValue);
     }
-    // Amp EQ
+    // Amp EQ, the targets are folded into the IR at once, the filters
+    // follow the smoothed gains
     else if (parameterID == "amp_eq_bass")
     {
-        amp_eq.setBassGain(juce::Decibels::decibelsToGain(newValue));
+        float gain = juce::Decibels::decibelsToGain(newValue);
+        smoothers.setTarget(smoothed.eq_bass, gain);
+        amp_eq.setBassGain(gain);
+        irConvolver.foldEQ(amp_eq);
     }
     else if (parameterID == "amp_eq_low_mid")
     {
-        amp_eq.setLowMidGain(juce::Decibels::decibelsToGain(newValue));
+        float gain = juce::Decibels::decibelsToGain(newValue);
+        smoothers.setTarget(smoothed.eq_low_mid, gain);
+        amp_eq.setLowMidGain(gain);
+        irConvolver.foldEQ(amp_eq);
     }
     else if (parameterID == "amp_eq_hi_mid")
     {
-        amp_eq.setHighMidGain(juce::Decibels::decibelsToGain(newValue));
+        float gain = juce::Decibels::decibelsToGain(newValue);
+        smoothers.setTarget(smoothed.eq_high_mid, gain);
+        amp_eq.setHighMidGain(gain);
+        irConvolver.foldEQ(amp_eq);
     }
     else if (parameterID == "amp_eq_treble")
     {
-        amp_eq.setTrebleGain(juce::Decibels::decibelsToGain(newValue));
+        float gain = juce::Decibels::decibelsToGain(newValue);
+        smoothers.setTarget(smoothed.eq_treble, gain);
+        amp_eq.setTrebleGain(gain);
+        irConvolver.foldEQ(amp_eq);
     }
     // Impulse Response Convolver
     else if (parameterID == "ir_bypass")
@@ -210,11 +289,23 @@ void PluginAudioProcessor::parameterChanged(
     }
     else if (parameterID == "ir_mix")
     {
-        irConvolver.setMix(newValue);
+        smoothers.setTarget(smoothed.ir_mix, newValue);
     }
     else if (parameterID == "ir_gain_db")
     {
-        irConvolver.setGain(juce::Decibels::decibelsToGain(newValue));
+        smoothers.setTarget(
+            smoothed.ir_gain, juce::Decibels::decibelsToGain(newValue)
+        );
+    }
+    else if (parameterID == "ir_eco")
+    {
+        isIREco = (newValue >= 0.5f);
+    }
+    else if (parameterID == "ir_fold_eq")
+    {
+        isAmpEQFolded = (newValue >= 0.5f);
+        irConvolver.setFoldEQ(isAmpEQFolded);
+        irConvolver.foldEQ(amp_eq);
     }
     else if (parameterID == "ir_filepath")
     {
@@ -223,6 +314,15 @@ void PluginAudioProcessor::parameterChanged(
             parameters.state.getProperty("ir_filepath").toString();
         irConvolver.setFilepath(newFilepath);
         irConvolver.loadIR();
+        irConvolver.foldEQ(amp_eq);
+    }
+    else if (parameterID == "quality_adaptive")
+    {
+        isQualityAdaptive = (newValue >= 0.5f);
+    }
+    else if (parameterID == "quality_budget")
+    {
+        quality.setBudget(newValue / 100.0f);
     }
 }
 
@@ -232,110 +332,145 @@ void PluginAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
     juce::ignoreUnused(sampleRate, samplesPerBlock);
-    previousInputGainLinear =
-        juce::Decibels::decibelsToGain(inputGainParameter->load());
-    previousOutputGainLinear =
-        juce::Decibels::decibelsToGain(outputGainParameter->load());
+    auto value = [this](const char* parameterID)
+    { return parameters.getRawParameterValue(parameterID)->load(); };
+    auto gain = [&value](const char* parameterID)
+    { return juce::Decibels::decibelsToGain(value(parameterID)); };
+
+    // Continuous parameters start at their values, without ramp
+    smoothers.prepare(sampleRate);
+    const float ratios[] = {2.0f, 4.0f, 8.0f, 12.0f, 20.0f};
+    smoothers.setCurrentAndTarget(
+        smoothed.input_gain, gain("input_gain_db")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.output_gain, gain("output_gain_db")
+    );
+    smoothers.setCurrentAndTarget(smoothed.amp_master, gain("amp_master"));
+    smoothers.setCurrentAndTarget(
+        smoothed.compressor_threshold, gain("compressor_threshold")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.compressor_ratio,
+        ratios[static_cast<int>(value("compressor_ratio"))]
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.compressor_level, gain("compressor_level_db")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.compressor_mix,
+        static_cast<int>(value("compressor_mix")) / 100.0f
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.compressor_low_crossover, value("compressor_low_crossover")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.compressor_high_crossover, value("compressor_high_crossover")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.overdrive_level, gain("overdrive_level_db")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.overdrive_drive, value("overdrive_drive")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.overdrive_character, value("overdrive_character")
+    );
+    smoothers.setCurrentAndTarget(
+        smoothed.overdrive_mix,
+        static_cast<int>(value("overdrive_mix")) / 100.0f
+    );
+    smoothers.setCurrentAndTarget(smoothed.eq_bass, gain("amp_eq_bass"));
+    smoothers.setCurrentAndTarget(smoothed.eq_low_mid, gain("amp_eq_low_mid"));
+    smoothers.setCurrentAndTarget(smoothed.eq_high_mid, gain("amp_eq_hi_mid"));
+    smoothers.setCurrentAndTarget(smoothed.eq_treble, gain("amp_eq_treble"));
+    smoothers.setCurrentAndTarget(smoothed.ir_mix, value("ir_mix"));
+    smoothers.setCurrentAndTarget(smoothed.ir_gain, gain("ir_gain_db"));
+    applySmoothedParameters(0);
+    silent_seconds = 0.0;
 
     juce::dsp::ProcessSpec spec;
     spec.sampleRate = sampleRate;
     spec.maximumBlockSize = (juce::uint32)samplesPerBlock;
     spec.numChannels = (juce::uint32)getTotalNumOutputChannels();
 
-    compressor.prepare(spec);
-
-    // Set all initial values from compressor
-    compressor.setBypass(
-        parameters.getRawParameterValue("compressor_bypass")->load() >= 0.5f
-    );
-    const float values[] = {2.0f, 4.0f, 8.0f, 12.0f, 20.0f};
-    int index = static_cast<int>(
-        parameters.getRawParameterValue("compressor_ratio")->load()
-    );
-    compressor.setRatio(values[index]);
-    compressor.setThreshold(
-        juce::Decibels::decibelsToGain(
-            parameters.getRawParameterValue("compressor_threshold")->load()
-        )
-    );
-    compressor.setLevel(
-        juce::Decibels::decibelsToGain(
-            parameters.getRawParameterValue("compressor_level_db")->load()
-        )
+    // The stages up to the amp only ever see sub-blocks
+    juce::dsp::ProcessSpec sub_block_spec = spec;
+    sub_block_spec.maximumBlockSize = juce::jmin(
+        spec.maximumBlockSize, static_cast<juce::uint32>(sub_block_size)
     );
-    compressor.setTypeFromIndex(
-        static_cast<int>(
-            parameters.getRawParameterValue("compressor_type")->load()
-        )
+
+    // Hosts call prepareToPlay on every transport start. With the same
+    // rate the circuits keep their state, and with the same sub-block too
+    // the amp stages are left as they are. The cabinet sorts out what its
+    // own spec changes.
+    bool rate_changed =
+        !juce::approximatelyEqual(sampleRate, amp_spec.sampleRate);
+    bool sub_block_changed =
+        rate_changed ||
+        sub_block_spec.maximumBlockSize != amp_spec.maximumBlockSize ||
+        sub_block_spec.numChannels != amp_spec.numChannels;
+    amp_spec = sub_block_spec;
+
+    scratch.prepare(
+        juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels()),
+        samplesPerBlock
     );
 
-    int amp_index =
-        static_cast<int>(parameters.getRawParameterValue("amp_type")->load());
-    current_overdrive = overdrives[amp_index];
+    if (sub_block_changed)
+        compressor.prepare(sub_block_spec);
+
+    // Set all initial values from compressor
+    compressor.setBypass(value("compressor_bypass") >= 0.5f);
+    compressor.setTypeFromIndex(static_cast<int>(value("compressor_type")));
+    compressor.setMultiband(value("compressor_multiband") >= 0.5f);
+    isCompressorOversampled = value("compressor_oversampled") >= 0.5f;
 
     // Set all initial values from overdrive
-    isAmpBypassed =
-        parameters.getRawParameterValue("amp_bypass")->load() >= 0.5f;
+    isAmpBypassed = value("amp_bypass") >= 0.5f;
     for (auto& overdrive : overdrives)
     {
-        overdrive->prepare(spec);
-        overdrive->setBypass(
-            parameters.getRawParameterValue("amp_bypass")->load() >= 0.5f
-        );
-        overdrive->setMix(
-            static_cast<int>(
-                parameters.getRawParameterValue("overdrive_mix")->load()
-            ) /
-            100.0f
-        );
-        overdrive->setLevel(
-            juce::Decibels::decibelsToGain(
-                parameters.getRawParameterValue("overdrive_level_db")->load()
-            )
-        );
-        overdrive->setDrive(
-            parameters.getRawParameterValue("overdrive_drive")->load()
-        );
-        overdrive->setCharacter(
-            parameters.getRawParameterValue("overdrive_character")->load()
-        );
+        if (sub_block_changed)
+            overdrive->prepare(sub_block_spec);
+        overdrive->setInputSaturation(&compressor);
+        overdrive->setScratchPool(&scratch);
+        overdrive->setBypass(isAmpBypassed);
     }
-
-    amp_eq.prepare(spec);
-    amp_eq.setBypass(
-        parameters.getRawParameterValue("amp_bypass")->load() >= 0.5f
-    );
-    amp_eq.setBassGain(
-        juce::Decibels::decibelsToGain(
-            parameters.getRawParameterValue("amp_eq_bass")->load()
-        )
-    );
-    amp_eq.setLowMidGain(
-        juce::Decibels::decibelsToGain(
-            parameters.getRawParameterValue("amp_eq_low_mid")->load()
-        )
-    );
-    amp_eq.setHighMidGain(
-        juce::Decibels::decibelsToGain(
-            parameters.getRawParameterValue("amp_eq_hi_mid")->load()
-        )
-    );
-    amp_eq.setTrebleGain(
-        juce::Decibels::decibelsToGain(
-            parameters.getRawParameterValue("amp_eq_treble")->load()
-        )
-    );
+    overdrive_switcher.select(static_cast<int>(value("amp_type")));
+    overdrive_switcher.setScratchPool(&scratch);
+    if (sub_block_changed)
+        overdrive_switcher.prepare(sub_block_spec);
+
+    if (rate_changed)
+        amp_eq.prepare(spec);
+    amp_eq.setBypass(isAmpBypassed);
+    amp_eq.setBassGain(gain("amp_eq_bass"));
+    amp_eq.setLowMidGain(gain("amp_eq_low_mid"));
+    amp_eq.setHighMidGain(gain("amp_eq_hi_mid"));
+    amp_eq.setTrebleGain(gain("amp_eq_treble"));
 
     // Set all initial values for IR convolution
     irConvolver.prepare(spec);
-    irConvolver.setBypass(
-        parameters.getRawParameterValue("ir_bypass")->load() >= 0.5f
-    );
-    irConvolver.setMix(parameters.getRawParameterValue("ir_mix")->load());
+    irConvolver.setScratchPool(&scratch);
+    irConvolver.setBypass(value("ir_bypass") >= 0.5f);
+    isIREco = value("ir_eco") >= 0.5f;
+    irConvolver.setEco(isIREco);
+    isAmpEQFolded = value("ir_fold_eq") >= 0.5f;
+    irConvolver.setFoldEQ(isAmpEQFolded);
     irConvolver.setFilepath(
         parameters.state.getProperty("ir_filepath").toString()
     );
-    irConvolver.loadIR();
+    // From the cache, unless the path or the file changed. The folded
+    // kernel is rebaked for a new IR or a new rate only.
+    bool ir_loaded = irConvolver.loadIR();
+    if (ir_loaded || rate_changed)
+        irConvolver.foldEQ(amp_eq);
+
+    isQualityAdaptive = value("quality_adaptive") >= 0.5f;
+    quality.setEnabled(isQualityAdaptive && !isNonRealtime());
+    quality.setBudget(value("quality_budget") / 100.0f);
+    quality.prepare(sampleRate);
+    applyQualityLevel();
 }
 
 void PluginAudioProcessor::releaseResources()
@@ -369,34 +504,62 @@ void PluginAudioProcessor::processBlock(
 {
     juce::ignoreUnused(midiMessages);
     juce::ScopedNoDenormals noDenormals;
+    quality.beginBlock();
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    applyInputGain(buffer);
-    updateInputLevel(buffer);
-
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    applyQualityLevel();
+    // The cabinet runs the amp EQ while folded, and until it has handed
+    // back to the plain chain
+    isAmpEQInCabinet =
+        (isAmpEQFolded && !isAmpBypassed) || irConvolver.isFolding();
+
+    // The stages up to the amp run the block sub_block_size samples at a
+    // time, each sub-block through all of them before the next, so that
+    // their state and the oversampled samples stay in cache whatever the
+    // host block size. The parameters are smoothed per sub-block too.
+    const int numSamples = buffer.getNumSamples();
+    float output_gain_start = smoothers.getEnd(smoothed.output_gain);
+    float input_peak = 0.0f;
+    for (int start = 0; start < numSamples; start += sub_block_size)
     {
-        auto* channelData = buffer.getWritePointer(channel);
-        juce::ignoreUnused(channelData);
+        juce::AudioBuffer<float> sub_block(
+            buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start,
+            juce::jmin(sub_block_size, numSamples - start)
+        );
+        input_peak = juce::jmax(input_peak, processAmp(sub_block));
     }
+    updateInputLevel(input_peak);
+    compressorGainReductionDb.setValue(gain_reduction_db);
+
+    // The convolution costs an FFT per call, the cabinet runs on the whole
+    // block
+    bool cabinet_asleep =
+        silent_seconds > overdrive_switcher.getTailSeconds() +
+                             amp_eq.getTailSeconds() +
+                             irConvolver.getTailSeconds();
+    if (cabinet_asleep)
+    {
+        buffer.clear();
+    }
+    else if (isAmpEQInCabinet)
+    {
+        // EQ, master gain and IR as one stage, see IRConvolver
+        irConvolver.process(
+            buffer, amp_eq,
+            isAmpBypassed ? 1.0f : smoothers.getEnd(smoothed.amp_master)
+        );
+    }
+    else
+    {
+        irConvolver.process(buffer);
+    }
+    irModelErrorDb.setValue(irConvolver.getModelErrorDb());
 
-    compressor.process(buffer);
-    compressorGainReductionDb.setValue(compressor.getGainReductionDb());
-
-    current_overdrive->process(buffer);
-
-    amp_eq.process(buffer);
-
-    if (!isAmpBypassed)
-        applyAmpMasterGain(buffer);
-
-    irConvolver.process(buffer);
-
-    applyOutputGain(buffer);
+    applyOutputGain(buffer, output_gain_start);
     updateOutputLevel(buffer);
 
     // Convert mono to stereo if needed
@@ -409,18 +572,73 @@ void PluginAudioProcessor::processBlock(
         left[i] = mono_sample;
         right[i] = mono_sample;
     }
+
+    quality.endBlock(buffer.getNumSamples());
+    qualityLevel.setValue(static_cast<int>(quality.getLevel()));
+}
+
+// Input gain, compressor, overdrive and, unless folded into the cabinet,
+// amp EQ and master gain. Returns the peak after the input gain.
+float PluginAudioProcessor::processAmp(juce::AudioBuffer<float>& buffer)
+{
+    applySmoothedParameters(buffer.getNumSamples());
+    applyInputGain(buffer);
+    float input_peak = buffer.getMagnitude(0, 0, buffer.getNumSamples());
+
+    if (input_peak < silence_threshold)
+        silent_seconds += buffer.getNumSamples() / getSampleRate();
+    else
+        silent_seconds = 0.0;
+
+    // The compressor sleeps once its state has come back to rest, so that
+    // it wakes up as if it had run. The EQ input is silent once the amp
+    // has rung out.
+    double overdrive_tail = overdrive_switcher.getTailSeconds();
+    bool compressor_asleep = silent_seconds > compressor.getSettleSeconds();
+    bool overdrive_asleep = silent_seconds > overdrive_tail;
+    bool amp_eq_asleep =
+        silent_seconds > overdrive_tail + amp_eq.getTailSeconds();
+
+    // The compressor saturation joins the overdrive oversampled block, when
+    // there is one.
+    compressor.setSaturationDeferred(isCompressorOversampled && !isAmpBypassed);
+    if (compressor_asleep)
+    {
+        buffer.clear();
+        gain_reduction_db = 0.0f;
+    }
+    else
+    {
+        compressor.process(buffer);
+        gain_reduction_db = compressor.getGainReductionDb();
+    }
+
+    if (overdrive_asleep)
+        overdrive_switcher.processSilence(buffer);
+    else
+        overdrive_switcher.process(buffer);
+
+    if (isAmpEQInCabinet)
+        return input_peak;
+    if (amp_eq_asleep)
+    {
+        buffer.clear();
+        return input_peak;
+    }
+    amp_eq.process(buffer);
+    if (!isAmpBypassed)
+        applyAmpMasterGain(buffer);
+    return input_peak;
 }
 
 //==============================================================================
 // Process Block Helper functions
 //==============================================================================
 
-void PluginAudioProcessor::updateInputLevel(juce::AudioBuffer<float>& buffer)
+void PluginAudioProcessor::updateInputLevel(float peak)
 {
     // Set inputLevel value for metering
-    double peakInput = smoothLevel(
-        buffer.getMagnitude(0, 0, buffer.getNumSamples()), inputLevel.getValue()
-    );
+    double peakInput = smoothLevel(peak, inputLevel.getValue());
     inputLevel.setValue(peakInput);
 }
 
@@ -436,64 +654,86 @@ void PluginAudioProcessor::updateOutputLevel(juce::AudioBuffer<float>& buffer)
 
 void PluginAudioProcessor::applyInputGain(juce::AudioBuffer<float>& buffer)
 {
-    auto currentInputGainLinear =
-        juce::Decibels::decibelsToGain(inputGainParameter->load());
-    if (juce::approximatelyEqual(
-            currentInputGainLinear, previousInputGainLinear
-        ))
-    {
-        buffer.applyGain(currentInputGainLinear);
-    }
-    else
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
     {
-        buffer.applyGainRamp(
-            0, buffer.getNumSamples(), previousInputGainLinear,
-            currentInputGainLinear
+        smoothers.applyRamp(
+            smoothed.input_gain, buffer.getWritePointer(channel),
+            buffer.getNumSamples()
         );
-        previousInputGainLinear = currentInputGainLinear;
     }
 }
 
-void PluginAudioProcessor::applyOutputGain(juce::AudioBuffer<float>& buffer)
+// Ramps across the whole block, from where the gain was at its start
+void PluginAudioProcessor::applyOutputGain(
+    juce::AudioBuffer<float>& buffer, float startGain
+)
 {
-    // Apply output gain with smoothing
-    auto currentOutputGainLinear =
-        juce::Decibels::decibelsToGain(outputGainParameter->load());
-    if (juce::approximatelyEqual(
-            currentOutputGainLinear, previousOutputGainLinear
-        ))
-    {
-        buffer.applyGain(currentOutputGainLinear);
-    }
-    else
+    float end_gain = smoothers.getEnd(smoothed.output_gain);
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
     {
         buffer.applyGainRamp(
-            0, buffer.getNumSamples(), previousOutputGainLinear,
-            currentOutputGainLinear
+            channel, 0, buffer.getNumSamples(), startGain, end_gain
         );
-        previousOutputGainLinear = currentOutputGainLinear;
     }
 }
 
 void PluginAudioProcessor::applyAmpMasterGain(juce::AudioBuffer<float>& buffer)
 {
-    // Apply output gain with smoothing
-    auto currentAmpMasterGainLinear =
-        juce::Decibels::decibelsToGain(ampMasterGainParameter->load());
-    if (juce::approximatelyEqual(
-            currentAmpMasterGainLinear, previousAmpMasterGainLinear
-        ))
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
     {
-        buffer.applyGain(currentAmpMasterGainLinear);
+        smoothers.applyRamp(
+            smoothed.amp_master, buffer.getWritePointer(channel),
+            buffer.getNumSamples()
+        );
     }
-    else
+}
+
+// Hands the level the governor picked from the previous blocks to the
+// stages, which crossfade to it. Offline renders have no deadline and stay
+// at full quality.
+void PluginAudioProcessor::applyQualityLevel()
+{
+    quality.setEnabled(isQualityAdaptive && !isNonRealtime());
+    auto level = quality.getLevel();
+    for (auto& overdrive : overdrives)
     {
-        buffer.applyGainRamp(
-            0, buffer.getNumSamples(), previousAmpMasterGainLinear,
-            currentAmpMasterGainLinear
+        overdrive->setReducedOversampling(
+            level >= QualityGovernor::reduced_oversampling
         );
-        previousAmpMasterGainLinear = currentAmpMasterGainLinear;
     }
+    compressor.setCoarseControl(level >= QualityGovernor::coarse_compressor);
+    irConvolver.setEco(isIREco || level >= QualityGovernor::eco_cabinet);
+}
+
+// Advances the continuous parameters by a block and hands the values they
+// reach to the stages. The stages ramp their gains from the previous block,
+// the other values are constant over the block.
+void PluginAudioProcessor::applySmoothedParameters(int numSamples)
+{
+    smoothers.advance(numSamples);
+    auto end = [this](int index) { return smoothers.getEnd(index); };
+
+    compressor.setThreshold(end(smoothed.compressor_threshold));
+    compressor.setRatio(end(smoothed.compressor_ratio));
+    compressor.setLevel(end(smoothed.compressor_level));
+    compressor.setMix(end(smoothed.compressor_mix));
+    compressor.setCrossoverFrequencies(
+        end(smoothed.compressor_low_crossover),
+        end(smoothed.compressor_high_crossover)
+    );
+
+    overdrive_switcher.setParameters(
+        end(smoothed.overdrive_level), end(smoothed.overdrive_drive),
+        end(smoothed.overdrive_character), end(smoothed.overdrive_mix)
+    );
+
+    amp_eq.setSmoothedGains(
+        end(smoothed.eq_bass), end(smoothed.eq_low_mid),
+        end(smoothed.eq_high_mid), end(smoothed.eq_treble)
+    );
+
+    irConvolver.setMix(end(smoothed.ir_mix));
+    irConvolver.setGain(end(smoothed.ir_gain));
 }
 
 double PluginAudioProcessor::smoothLevel(double newLevel, double currentLevel)
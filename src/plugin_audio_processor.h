@@ -6,6 +6,10 @@
 #include "dsp/overdrives/borealis.h"
 #include "dsp/overdrives/helios.h"
 #include "dsp/overdrives/overdrive.h"
+#include "dsp/overdrives/overdrive_switcher.h"
+#include "dsp/quality_governor.h"
+#include "dsp/scratch_pool.h"
+#include "dsp/smoother_bank.h"
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 
@@ -35,11 +39,16 @@ class PluginAudioProcessor final
     juce::Value inputLevel;                // in dB
     juce::Value outputLevel;               // in dB
     juce::Value compressorGainReductionDb; // in dB
-    void updateInputLevel(juce::AudioBuffer<float>& buffer);
+    juce::Value irModelErrorDb;            // in dB, negative if not fitted
+    juce::Value qualityLevel;              // QualityGovernor::Level
+    void updateInputLevel(float peak);
     void updateOutputLevel(juce::AudioBuffer<float>& buffer);
+    float processAmp(juce::AudioBuffer<float>& buffer);
     void applyInputGain(juce::AudioBuffer<float>& buffer);
-    void applyOutputGain(juce::AudioBuffer<float>& buffer);
+    void applyOutputGain(juce::AudioBuffer<float>& buffer, float startGain);
     void applyAmpMasterGain(juce::AudioBuffer<float>& buffer);
+    void applySmoothedParameters(int numSamples);
+    void applyQualityLevel();
     double smoothLevel(double newLevel, double currentLevel);
 
     juce::AudioProcessorEditor* createEditor() override;
@@ -65,7 +74,6 @@ class PluginAudioProcessor final
     juce::AudioProcessorValueTreeState parameters;
     Compressor compressor;
 
-    Overdrive* current_overdrive = nullptr;
     HeliosOverdrive helios_overdrive;
     BorealisOverdrive borealis_overdrive;
 
@@ -73,16 +81,63 @@ class PluginAudioProcessor final
 
     IRConvolver irConvolver;
 
-    float previousInputGainLinear;
-    float previousOutputGainLinear;
-    float previousAmpMasterGainLinear;
-    std::atomic<float>* inputGainParameter = nullptr;
-    std::atomic<float>* outputGainParameter = nullptr;
-    std::atomic<float>* ampMasterGainParameter = nullptr;
+    // Shared by the stages for their dry or wet copies
+    ScratchPool scratch;
+
+    QualityGovernor quality;
+
+    // Continuous parameters, set by the listener and handed to the stages
+    // once per block
+    SmootherBank smoothers;
+    static constexpr float smoothing_seconds = 0.05f;
+    struct
+    {
+        int input_gain;
+        int output_gain;
+        int amp_master;
+        int compressor_threshold;
+        int compressor_ratio;
+        int compressor_level;
+        int compressor_mix;
+        int compressor_low_crossover;
+        int compressor_high_crossover;
+        int overdrive_level;
+        int overdrive_drive;
+        int overdrive_character;
+        int overdrive_mix;
+        int eq_bass;
+        int eq_low_mid;
+        int eq_high_mid;
+        int eq_treble;
+        int ir_mix;
+        int ir_gain;
+    } smoothed;
+    // Samples the stages up to the amp process at a time, a multiple of
+    // the compressor control intervals
+    static constexpr int sub_block_size = 64;
+    // What the amp stages were last prepared for, prepareToPlay only
+    // redoes what a new spec changes
+    juce::dsp::ProcessSpec amp_spec{-1, 0, 0};
+
+    // The stages sleep through silence: each is skipped, and its output
+    // zeroed, once the input has been below silence_threshold for longer
+    // than it takes the stage to ring out
+    static constexpr float silence_threshold = 1e-5f; // -100 dB
+    double silent_seconds = 0.0;
+    // Of the last sub-block, the meter is updated once per block
+    float gain_reduction_db = 0.0f;
+
     bool isAmpBypassed = false;
+    bool isAmpEQFolded = false;
+    bool isAmpEQInCabinet = false;
+    bool isCompressorOversampled = false;
+    bool isIREco = false;
+    bool isQualityAdaptive = true;
 
     std::vector<Overdrive*> overdrives = {
         &helios_overdrive, &borealis_overdrive
     };
+    // Indexed by amp_type
+    OverdriveSwitcher overdrive_switcher{overdrives};
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginAudioProcessor)
 };
@@ -11,8 +11,14 @@ PluginEditor::PluginEditor(
     PluginAudioProcessor& p, juce::AudioProcessorValueTreeState& params
 )
     : AudioProcessorEditor(&p), processorRef(p), parameters(params),
-      header(params, processorRef.inputLevel, processorRef.outputLevel),
-      tabs(params, processorRef.compressorGainReductionDb)
+      header(
+          params, processorRef.inputLevel, processorRef.outputLevel,
+          processorRef.qualityLevel
+      ),
+      tabs(
+          params, processorRef.compressorGainReductionDb,
+          processorRef.irModelErrorDb
+      )
 {
 
     setLookAndFeel(new BaseLookAndFeel());